@@ -5,13 +5,95 @@
 // We switched to C++ for this task for better performance
 
 #include <fstream>
+#include <sstream>
 #include <string>
 #include <random>
 #include <iostream>
+#include <vector>
+#include <algorithm>
+#include <numeric>
+#include <chrono>
+#include <cmath>
+#include <thread>
+#include <atomic>
+#include <array>
+#include <memory>
+#include <cstring>
+#include <csignal>
+#include <list>
+#include <map>
+#include <deque>
+#include <tuple>
+#include <mutex>
+#include <condition_variable>
+#include <future>
 #include <getopt.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+// Chain statistics used by the generator
+// bernoulli - independent monomers (or fixed composition with --fixed)
+// terminal - first-order Markov chain from Mayo-Lewis reactivity ratios
+// penultimate - second-order Markov chain (the last two units set the next one)
+enum class Model {
+    bernoulli,
+    terminal,
+    penultimate
+}; // Model
+
+// Chain length distribution of the replicates around the sweep's mean n
+// monodisperse - every chain has exactly n units (default)
+// flory - most probable distribution, PDI ~ 2
+// schulz - Schulz-Zimm distribution with shape k, PDI ~ 1 + 1/k
+// poisson - 1 + Poisson(n - 1), as from an ideal living polymerization
+enum class LengthDist {
+    monodisperse,
+    flory,
+    schulz,
+    poisson
+}; // LengthDist
 
 class Args {
 private:
+    // Parse a comma-separated list of numbers (e.g. "1,0.5,2")
+    static std::vector<double> parse_list(const char * arg) {
+        std::vector<double> values;
+        std::string list(arg);
+        size_t start = 0;
+        while (start <= list.size()) {
+            size_t end = list.find(',', start);
+            if (end == std::string::npos) end = list.size();
+            values.push_back(std::stod(list.substr(start, end - start)));
+            start = end + 1;
+        }
+        return values;
+    }  // parse_list()
+
+    // Parse a comma-separated list of names
+    static std::vector<std::string> parse_names(const char * arg) {
+        std::vector<std::string> names;
+        std::string list(arg);
+        for(size_t begin = 0; begin <= list.size();) {
+            size_t end = std::min(list.find(',', begin), list.size());
+            if (end > begin) names.push_back(list.substr(begin, end - begin));
+            begin = end + 1;
+        }
+        return names;
+    }  // parse_names()
+
+    // Parse the optional argument of an on/off flag (--flag, --flag=1, --flag=false)
+    static bool parse_flag(const char * arg) {
+        if (!arg) return true;
+        if(arg[0] == '0' || std::string(arg) == "false") return false;
+        if(arg[0] == '1' || std::string(arg) == "true") return true;
+        std::cerr << "Error: invalid option\n";
+        exit(1);
+    }  // parse_flag()
+
     void get_mode(int argc, char * argv[]) {
         opterr = false;
 
@@ -21,34 +103,216 @@ private:
             {"g_prob", required_argument, nullptr, 'g'},
             {"fixed", optional_argument, nullptr, 'f'},
             {"dimers", optional_argument, nullptr, 'd'},
+            {"exact", optional_argument, nullptr, 'x'},
+            {"threads", required_argument, nullptr, 't'},
+            {"enumerate", optional_argument, nullptr, 'e'},
+            {"n_min", required_argument, nullptr, 'm'},
+            {"n_max", required_argument, nullptr, 'M'},
+            {"n_step", required_argument, nullptr, 's'},
+            {"direct", optional_argument, nullptr, 'D'},
+            {"model", required_argument, nullptr, 'o'},
+            {"r_L", required_argument, nullptr, 'L'},
+            {"r_G", required_argument, nullptr, 'G'},
+            {"r_GL", required_argument, nullptr, 'l'},
+            {"r_LG", required_argument, nullptr, 'k'},
+            {"kmc", required_argument, nullptr, 'K'},
+            {"rates", required_argument, nullptr, 'R'},
+            {"lengths", required_argument, nullptr, 'P'},
+            {"schulz_k", required_argument, nullptr, 'Z'},
+            {"monomers", required_argument, nullptr, 'A'},
+            {"cyclic", optional_argument, nullptr, 'c'},
+            {"gradient", optional_argument, nullptr, 'w'},
+            {"conversion", required_argument, nullptr, 'X'},
+            {"dimer_probs", required_argument, nullptr, 'H'},
+            {"kmers", required_argument, nullptr, 'q'},
+            {"runs", required_argument, nullptr, 'u'},
+            {"quantiles", optional_argument, nullptr, 'Q'},
+            {"bootstrap", required_argument, nullptr, 'b'},
+            {"store", required_argument, nullptr, 'S'},
+            {"load", required_argument, nullptr, 'O'},
+            {"metrics", required_argument, nullptr, 'y'},
+            {"covariance", optional_argument, nullptr, 'V'},
+            {"seed", required_argument, nullptr, 'j'},
+            {"shard", required_argument, nullptr, 'J'},
+            {"serve", required_argument, nullptr, 'U'},
+            {"surface", required_argument, nullptr, 'W'},
+            {"g_nodes", required_argument, nullptr, 'I'},
+            {"fit", required_argument, nullptr, 'F'},
+            {"sensitivity", optional_argument, nullptr, 'T'},
+            {"stratified", optional_argument, nullptr, 'Y'},
+            {"qmc", optional_argument, nullptr, 'E'},
+            {"self_check", optional_argument, nullptr, 'C'},
             {nullptr, 0, nullptr, 0}
         };  // long_options[]
 
-        while ((choice = getopt_long(argc, argv, "g:f::d::", long_options, &index)) != -1) {
+        while ((choice = getopt_long(argc, argv, "g:f::d::x::t:e::m:M:s:D::o:L:G:l:k:K:R:P:Z:A:c::w::X:H:q:u:Q::b:S:O:y:V::j:J:U:W:I:F:T::Y::E::C::", long_options, &index)) != -1) {
             switch (choice) {
                 case 'g':
                     _g_prob = std::stod(optarg);
                     break;
                 case 'f':
-                    _fixed = true;
-                    if (optarg) {
-                        if(optarg[0] == '0' || std::string(optarg) == "false") _fixed = false;
-                        else if(optarg[0] == '1' || std::string(optarg) == "true") _fixed = true;
-                        else {
-                            std::cerr << "Error: invalid option\n";
-                            exit(1);
-                        }
-                    }
+                    _fixed = parse_flag(optarg);
                     break;
                 case 'd':
-                    _dimers = true;
-                    if (optarg) {
-                        if(optarg[0] == '0' || std::string(optarg) == "false") _dimers = false;
-                        else if(optarg[0] == '1' || std::string(optarg) == "true") _dimers = true;
-                        else {
-                            std::cerr << "Error: invalid option\n";
-                            exit(1);
-                        }
+                    _dimers = parse_flag(optarg);
+                    break;
+                case 'x':
+                    _exact = parse_flag(optarg);
+                    break;
+                case 't':
+                    _threads = std::stoi(optarg);
+                    if (_threads < 1) {
+                        std::cerr << "Error: --threads must be at least 1\n";
+                        exit(1);
+                    }
+                    break;
+                case 'e':
+                    _enumerate = parse_flag(optarg);
+                    break;
+                case 'm':
+                    _n_min = std::stoi(optarg);
+                    break;
+                case 'M':
+                    _n_max = std::stoi(optarg);
+                    break;
+                case 's':
+                    _n_step = std::stoi(optarg);
+                    break;
+                case 'D':
+                    _direct = parse_flag(optarg);
+                    break;
+                case 'o':
+                    if (std::string(optarg) == "bernoulli") _model = Model::bernoulli;
+                    else if (std::string(optarg) == "terminal") _model = Model::terminal;
+                    else if (std::string(optarg) == "penultimate") _model = Model::penultimate;
+                    else {
+                        std::cerr << "Error: unknown model " << optarg << "\n";
+                        exit(1);
+                    }
+                    break;
+                case 'L':
+                    _r_L = std::stod(optarg);
+                    break;
+                case 'G':
+                    _r_G = std::stod(optarg);
+                    break;
+                case 'l':
+                    _r_GL = std::stod(optarg);
+                    break;
+                case 'k':
+                    _r_LG = std::stod(optarg);
+                    break;
+                case 'K':
+                    _kmc_events = std::stoll(optarg);
+                    break;
+                case 'R':
+                    _rates = parse_list(optarg);
+                    break;
+                case 'P':
+                    if (std::string(optarg) == "monodisperse") _lengths = LengthDist::monodisperse;
+                    else if (std::string(optarg) == "flory") _lengths = LengthDist::flory;
+                    else if (std::string(optarg) == "schulz") _lengths = LengthDist::schulz;
+                    else if (std::string(optarg) == "poisson") _lengths = LengthDist::poisson;
+                    else {
+                        std::cerr << "Error: unknown length distribution " << optarg << "\n";
+                        exit(1);
+                    }
+                    break;
+                case 'Z':
+                    _schulz_k = std::stod(optarg);
+                    break;
+                case 'A':
+                    _monomers = parse_list(optarg);
+                    break;
+                case 'c':
+                    _cyclic = parse_flag(optarg);
+                    break;
+                case 'w':
+                    // --gradient drifts the feed by conversion, --gradient=file reads a profile
+                    _gradient = true;
+                    if (optarg) _gradient_file = optarg;
+                    break;
+                case 'X':
+                    _conversion = std::stod(optarg);
+                    break;
+                case 'H':
+                    _dimer_probs = parse_list(optarg);
+                    break;
+                case 'q':
+                    _kmers = std::stoi(optarg);
+                    if (_kmers < 1 || _kmers > 8) {
+                        std::cerr << "Error: --kmers must be between 1 and 8\n";
+                        exit(1);
+                    }
+                    break;
+                case 'Q':
+                    _quantiles = parse_flag(optarg);
+                    break;
+                case 'S':
+                    _store = optarg;
+                    break;
+                case 'O':
+                    _load = optarg;
+                    break;
+                case 'y':
+                    _metrics = parse_names(optarg);
+                    break;
+                case 'V':
+                    _covariance = parse_flag(optarg);
+                    break;
+                case 'j':
+                    _seed = std::stoull(optarg);
+                    _seed_given = true;
+                    break;
+                case 'J':
+                    // i/k: this process runs shard i of k
+                    if (sscanf(optarg, "%d/%d", &_shard_index, &_shard_count) != 2 
+                        || _shard_count < 1 || _shard_index < 0 || _shard_index >= _shard_count) {
+                        std::cerr << "Error: --shard takes i/k with 0 <= i < k\n";
+                        exit(1);
+                    }
+                    _sharded = true;
+                    break;
+                case 'U':
+                    _serve = optarg;
+                    break;
+                case 'W':
+                    _surface = optarg;
+                    break;
+                case 'F':
+                    _fit = optarg;
+                    break;
+                case 'T':
+                    _sensitivity = parse_flag(optarg);
+                    break;
+                case 'Y':
+                    _stratified = parse_flag(optarg);
+                    break;
+                case 'E':
+                    _qmc = parse_flag(optarg);
+                    break;
+                case 'C':
+                    _self_check = parse_flag(optarg);
+                    break;
+                case 'I':
+                    _g_nodes = std::stoi(optarg);
+                    if (_g_nodes < 2) {
+                        std::cerr << "Error: --g_nodes needs at least 2 nodes\n";
+                        exit(1);
+                    }
+                    break;
+                case 'b':
+                    _bootstrap = std::stoi(optarg);
+                    if (_bootstrap < 2) {
+                        std::cerr << "Error: --bootstrap needs at least 2 resamples\n";
+                        exit(1);
+                    }
+                    break;
+                case 'u':
+                    _runs = std::stoi(optarg);
+                    if (_runs < 1) {
+                        std::cerr << "Error: --runs must be at least 1\n";
+                        exit(1);
                     }
                     break;
                 case 'h':
@@ -58,17 +322,295 @@ private:
                     exit(1);
             }  // switch
         }  // while
+
+        if (_n_min < 2 || _n_max < _n_min || _n_step < 1) {
+            std::cerr << "Error: invalid sweep range\n";
+            exit(1);
+        }
+
+        if (_direct && !_fixed) {
+            std::cerr << "Error: --direct requires --fixed\n";
+            exit(1);
+        }
+
+        if (_model != Model::bernoulli && (_fixed || _enumerate)) {
+            std::cerr << "Error: --fixed and --enumerate only apply to the bernoulli model\n";
+            exit(1);
+        }
+
+        if (_model == Model::penultimate && _exact) {
+            std::cerr << "Error: --exact applies to the bernoulli and terminal models\n";
+            exit(1);
+        }
+
+        // penultimate ratios default to the terminal ones (no penultimate effect)
+        if (std::isnan(_r_GL)) _r_GL = _r_L;
+        if (std::isnan(_r_LG)) _r_LG = _r_G;
+
+        if (_lengths != LengthDist::monodisperse && (_exact || _enumerate || _direct)) {
+            std::cerr << "Error: --lengths only applies to sampled sequences\n";
+            exit(1);
+        }
+
+        if (!_monomers.empty()) {
+            if (_monomers.size() < 2 || _monomers.size() > 8 
+                || *std::min_element(_monomers.begin(), _monomers.end()) < 0 
+                || *std::max_element(_monomers.begin(), _monomers.end()) <= 0) {
+                std::cerr << "Error: --monomers takes 2 to 8 non-negative weights\n";
+                exit(1);
+            }
+            if (_model != Model::bernoulli || _fixed || _exact || _enumerate || _direct) {
+                std::cerr << "Error: --monomers only supports the unfixed bernoulli model\n";
+                exit(1);
+            }
+        }
+
+        if (_cyclic && _kmc_events > 0) {
+            std::cerr << "Error: --kmc only simulates linear chains\n";
+            exit(1);
+        }
+
+        if (_kmc_events > 0 && (_lengths != LengthDist::monodisperse || _direct || !_monomers.empty())) {
+            std::cerr << "Error: --kmc evolves generated monodisperse L/G chains, without --lengths, --direct or --monomers\n";
+            exit(1);
+        }
+
+        if (_gradient && (_fixed || _exact || _enumerate || _direct || !_monomers.empty())) {
+            std::cerr << "Error: --gradient only applies to sampled L/G sequences without --fixed\n";
+            exit(1);
+        }
+
+        if (!_dimer_probs.empty()) {
+            if (_dimer_probs.size() != 4 || *std::min_element(_dimer_probs.begin(), _dimer_probs.end()) < 0 
+                || *std::max_element(_dimer_probs.begin(), _dimer_probs.end()) <= 0) {
+                std::cerr << "Error: --dimer_probs takes four non-negative weights LL,GG,LG,GL\n";
+                exit(1);
+            }
+            if (_model != Model::bernoulli || _fixed || _exact || _enumerate || _direct 
+                || _gradient || !_monomers.empty()) {
+                std::cerr << "Error: --dimer_probs only supports sampled bernoulli dimers without --fixed\n";
+                exit(1);
+            }
+            _dimers = true;
+        }
+
+        if ((_kmers > 0 || _runs > 0) && (_exact || _enumerate || _direct || !_monomers.empty() || _kmc_events > 0)) {
+            std::cerr << "Error: --kmers and --runs only apply to sampled L/G sequences\n";
+            exit(1);
+        }
+
+        if ((!_metrics.empty() || _covariance) && (_exact || _enumerate || !_monomers.empty() || _kmc_events > 0)) {
+            std::cerr << "Error: --metrics and --covariance only apply to the sampled L/G sweep and --load\n";
+            exit(1);
+        }
+
+        if (_sharded) {
+            if (!_seed_given) {
+                std::cerr << "Error: --shard needs a --seed shared by all shards\n";
+                exit(1);
+            }
+            if (_exact || _enumerate || !_monomers.empty() || _kmc_events > 0 || !_load.empty() 
+                || _kmers > 0 || _runs > 0 || _quantiles || _bootstrap > 0 || !_store.empty()) {
+                std::cerr << "Error: --shard supports the sampled sweep with --metrics and --covariance\n";
+                exit(1);
+            }
+        }
+
+        if (!_serve.empty() && (_exact || _enumerate || !_monomers.empty() || _kmc_events > 0 || !_load.empty() 
+                                || _sharded || !_store.empty() || _kmers > 0 || _runs > 0 || _quantiles 
+                                || _bootstrap > 0 || !_metrics.empty() || _covariance)) {
+            std::cerr << "Error: --serve answers sampled L_L/L_G points and takes only generator options\n";
+            exit(1);
+        }
+
+        if (!_surface.empty()) {
+            if (_enumerate || !_monomers.empty() || _kmc_events > 0 || !_load.empty() || _sharded 
+                || !_serve.empty() || !_store.empty() || _kmers > 0 || _runs > 0 || _quantiles 
+                || _bootstrap > 0 || !_metrics.empty() || _covariance || !_dimer_probs.empty()) {
+                std::cerr << "Error: --surface tabulates L_L/L_G over g_prob and takes only generator options\n";
+                exit(1);
+            }
+            if (_n_max - _n_min < _n_step) {
+                std::cerr << "Error: --surface needs at least two sweep sizes\n";
+                exit(1);
+            }
+        }
+
+        if (!_fit.empty()) {
+            if (_model == Model::penultimate || _fixed || _lengths != LengthDist::monodisperse || _gradient 
+                || !_dimer_probs.empty() || _enumerate || !_monomers.empty() || _kmc_events > 0 
+                || !_load.empty() || _sharded || !_serve.empty() || !_surface.empty() || !_store.empty() 
+                || _kmers > 0 || _runs > 0 || _quantiles || _bootstrap > 0 || !_metrics.empty() || _covariance) {
+                std::cerr << "Error: --fit fits the exact bernoulli or terminal model and takes only --dimers and --cyclic\n";
+                exit(1);
+            }
+        }
+
+        if (_sensitivity) {
+            if (_model != Model::bernoulli || _fixed || _gradient || !_dimer_probs.empty() || _exact 
+                || _enumerate || !_monomers.empty() || _kmc_events > 0 || !_load.empty() || _sharded 
+                || !_serve.empty() || !_surface.empty() || !_fit.empty()) {
+                std::cerr << "Error: --sensitivity applies to the sampled sweep of unfixed bernoulli chains\n";
+                exit(1);
+            }
+            if (_g_prob <= 0 || _g_prob >= 1) {
+                std::cerr << "Error: --sensitivity needs 0 < g_prob < 1\n";
+                exit(1);
+            }
+        }
+
+        if (_stratified) {
+            if (_model != Model::bernoulli || _fixed || _lengths != LengthDist::monodisperse || _gradient 
+                || !_dimer_probs.empty() || _exact || _enumerate || !_monomers.empty() || _kmc_events > 0 
+                || !_load.empty() || _sharded || !_serve.empty() || !_surface.empty() || !_fit.empty() 
+                || !_store.empty() || _kmers > 0 || _runs > 0 || _quantiles || _bootstrap > 0 
+                || !_metrics.empty() || _covariance || _sensitivity) {
+                std::cerr << "Error: --stratified estimates L_L/L_G of unfixed monodisperse bernoulli chains\n";
+                exit(1);
+            }
+            if (_g_prob <= 0 || _g_prob >= 1) {
+                std::cerr << "Error: --stratified needs 0 < g_prob < 1\n";
+                exit(1);
+            }
+        }
+
+        if (_qmc && (_model != Model::bernoulli || _fixed || _lengths != LengthDist::monodisperse || _gradient || !_dimer_probs.empty() || _exact 
+                     || _enumerate || !_monomers.empty() || _kmc_events > 0 || !_load.empty() || _sharded 
+                     || !_serve.empty() || !_surface.empty() || !_fit.empty() || _stratified || !_store.empty() 
+                     || _kmers > 0 || _runs > 0 || _bootstrap > 0 || !_metrics.empty() || _covariance 
+                     || _sensitivity)) {
+            std::cerr << "Error: --qmc estimates the L_L/L_G means of the sampled sweep of unfixed bernoulli chains\n";
+            exit(1);
+        }
+
+        if (_self_check && (_model == Model::penultimate || _fixed || _dimers || _direct 
+                            || _lengths != LengthDist::monodisperse || _gradient || !_dimer_probs.empty() 
+                            || _exact || _enumerate || !_monomers.empty() || _kmc_events > 0 || !_load.empty() 
+                            || _sharded || !_serve.empty() || !_surface.empty() || !_fit.empty() || _stratified 
+                            || _qmc || !_store.empty() || _kmers > 0 || _runs > 0 || _quantiles || _bootstrap > 0 
+                            || !_metrics.empty() || _covariance || _sensitivity)) {
+            std::cerr << "Error: --self_check takes only --g_prob, the bernoulli or terminal model, --cyclic and --seed\n";
+            exit(1);
+        }
+
+        if (!_store.empty() && (_exact || _enumerate || !_monomers.empty() || _kmc_events > 0)) {
+            std::cerr << "Error: --store only applies to the sampled L/G sweep\n";
+            exit(1);
+        }
+
+        if ((_quantiles || _bootstrap > 0) && (_exact || _enumerate || !_monomers.empty() || _kmc_events > 0)) {
+            std::cerr << "Error: --quantiles and --bootstrap only apply to the sampled L/G sweep\n";
+            exit(1);
+        }
+
+        if (_conversion <= 0 || _conversion >= 1) {
+            std::cerr << "Error: --conversion must be between 0 and 1\n";
+            exit(1);
+        }
+
+        if (_schulz_k <= 0) {
+            std::cerr << "Error: --schulz_k must be positive\n";
+            exit(1);
+        }
+
+        if (_rates.size() != 4 || *std::min_element(_rates.begin(), _rates.end()) < 0 
+            || *std::max_element(_rates.begin(), _rates.end()) <= 0) {
+            std::cerr << "Error: --rates takes four non-negative rates LL,LG,GL,GG\n";
+            exit(1);
+        }
+
+        if (_r_L < 0 || _r_G < 0 || _r_GL < 0 || _r_LG < 0) {
+            std::cerr << "Error: reactivity ratios must be non-negative\n";
+            exit(1);
+        }
     }  // getMode()    
 
     double _g_prob;
     bool _fixed;
     bool _dimers;
+    bool _exact;
+    int _threads;
+    bool _enumerate;
+    int _n_min;
+    int _n_max;
+    int _n_step;
+    bool _direct;
+    Model _model;
+    double _r_L;
+    double _r_G;
+    double _r_GL;
+    double _r_LG;
+    long long _kmc_events;
+    std::vector<double> _rates;
+    LengthDist _lengths;
+    double _schulz_k;
+    std::vector<double> _monomers;
+    bool _cyclic;
+    bool _gradient;
+    std::string _gradient_file;
+    double _conversion;
+    std::vector<double> _dimer_probs;
+    int _kmers;
+    int _runs;
+    bool _quantiles;
+    int _bootstrap;
+    std::string _store;
+    std::string _load;
+    std::vector<std::string> _metrics;
+    bool _covariance;
+    uint64_t _seed;
+    bool _seed_given;
+    bool _sharded;
+    int _shard_index;
+    int _shard_count;
+    std::string _serve;
+    std::string _surface;
+    int _g_nodes;
+    std::string _fit;
+    bool _sensitivity;
+    bool _stratified;
+    bool _qmc;
+    bool _self_check;
 
 public:
     Args(int argc, char * argv[]) {
         _g_prob = 0.25;
         _fixed = false;
         _dimers = false;
+        _exact = false;
+        _threads = std::max(1u, std::thread::hardware_concurrency());
+        _enumerate = false;
+        _n_min = 40;
+        _n_max = 3000;
+        _n_step = 8;
+        _direct = false;
+        _model = Model::bernoulli;
+        _r_L = 1.0;
+        _r_G = 1.0;
+        _r_GL = NAN;
+        _r_LG = NAN;
+        _kmc_events = 0;
+        _rates = {1.0, 1.0, 1.0, 1.0};
+        _lengths = LengthDist::monodisperse;
+        _schulz_k = 2.0;
+        _cyclic = false;
+        _gradient = false;
+        _conversion = 0.9;
+        _kmers = 0;
+        _runs = 0;
+        _quantiles = false;
+        _bootstrap = 0;
+        _covariance = false;
+        _seed = std::chrono::system_clock::now().time_since_epoch().count();
+        _seed_given = false;
+        _sharded = false;
+        _shard_index = 0;
+        _shard_count = 1;
+        _g_nodes = 41;
+        _sensitivity = false;
+        _stratified = false;
+        _qmc = false;
+        _self_check = false;
         get_mode(argc, argv);
     }  // Args()
 
@@ -83,11 +625,232 @@ public:
     bool dimers() const {
         return _dimers;
     }  // dimers()
+
+    bool exact() const {
+        return _exact;
+    }  // exact()
+
+    int threads() const {
+        return _threads;
+    }  // threads()
+
+    bool enumerate() const {
+        return _enumerate;
+    }  // enumerate()
+
+    int n_min() const {
+        return _n_min;
+    }  // n_min()
+
+    int n_max() const {
+        return _n_max;
+    }  // n_max()
+
+    int n_step() const {
+        return _n_step;
+    }  // n_step()
+
+    bool direct() const {
+        return _direct;
+    }  // direct()
+
+    Model model() const {
+        return _model;
+    }  // model()
+
+    double r_L() const {
+        return _r_L;
+    }  // r_L()
+
+    double r_G() const {
+        return _r_G;
+    }  // r_G()
+
+    double r_GL() const {
+        return _r_GL;
+    }  // r_GL()
+
+    double r_LG() const {
+        return _r_LG;
+    }  // r_LG()
+
+    long long kmc_events() const {
+        return _kmc_events;
+    }  // kmc_events()
+
+    const std::vector<double>& rates() const {
+        return _rates;
+    }  // rates()
+
+    LengthDist lengths() const {
+        return _lengths;
+    }  // lengths()
+
+    double schulz_k() const {
+        return _schulz_k;
+    }  // schulz_k()
+
+    // Per-type probabilities of the multi-monomer generator (empty for the L/G engine)
+    const std::vector<double>& monomers() const {
+        return _monomers;
+    }  // monomers()
+
+    bool cyclic() const {
+        return _cyclic;
+    }  // cyclic()
+
+    bool gradient() const {
+        return _gradient;
+    }  // gradient()
+
+    // Feed profile table for --gradient=file (empty for conversion drift)
+    const std::string& gradient_file() const {
+        return _gradient_file;
+    }  // gradient_file()
+
+    double conversion() const {
+        return _conversion;
+    }  // conversion()
+
+    // Weights of LL, GG, LG and GL dimers (empty unless mixed dimers are fed)
+    const std::vector<double>& dimer_probs() const {
+        return _dimer_probs;
+    }  // dimer_probs()
+
+    // Length of the sequences counted for NMR comparison (0 - off)
+    int kmers() const {
+        return _kmers;
+    }  // kmers()
+
+    // Longest run length given its own histogram bin (0 - off)
+    int runs() const {
+        return _runs;
+    }  // runs()
+
+    // Write L_L/L_G quantiles and histograms next to the means
+    bool quantiles() const {
+        return _quantiles;
+    }  // quantiles()
+
+    // Bootstrap resamples per n for confidence intervals (0 - off)
+    int bootstrap() const {
+        return _bootstrap;
+    }  // bootstrap()
+
+    // Dyad count store written by the sampled sweep (empty - none)
+    const std::string& store() const {
+        return _store;
+    }  // store()
+
+    // Dyad count store to re-analyse instead of generating (empty - none)
+    const std::string& load() const {
+        return _load;
+    }  // load()
+
+    // Names of the registry metrics to report besides L_L and L_G
+    const std::vector<std::string>& metrics() const {
+        return _metrics;
+    }  // metrics()
+
+    // Write the per-n covariance of the dyad counts, L_L and L_G
+    bool covariance() const {
+        return _covariance;
+    }  // covariance()
+
+    // Run seed (the clock unless --seed is given)
+    uint64_t seed() const {
+        return _seed;
+    }  // seed()
+
+    bool sharded() const {
+        return _sharded;
+    }  // sharded()
+
+    int shard_index() const {
+        return _shard_index;
+    }  // shard_index()
+
+    int shard_count() const {
+        return _shard_count;
+    }  // shard_count()
+
+    // Unix socket the query daemon listens on (empty - run the sweep)
+    const std::string& serve() const {
+        return _serve;
+    }  // serve()
+
+    // Interpolation surface to build from an (n, g_prob) grid (empty - run the sweep)
+    const std::string& surface() const {
+        return _surface;
+    }  // surface()
+
+    // Number of g_prob nodes of the surface, evenly spaced over [0, 1]
+    int g_nodes() const {
+        return _g_nodes;
+    }  // g_nodes()
+
+    // Measured L_L/L_G to fit the model parameters to (empty - run the sweep)
+    const std::string& fit() const {
+        return _fit;
+    }  // fit()
+
+    // Write dL_L/dg_prob and dL_G/dg_prob next to the means
+    bool sensitivity() const {
+        return _sensitivity;
+    }  // sensitivity()
+
+    // Stratify the replicates by G count (Neyman allocation) instead of plain sampling
+    bool stratified() const {
+        return _stratified;
+    }  // stratified()
+
+    // Draw unfixed bernoulli chains from scrambled Sobol points (one randomization per block)
+    bool qmc() const {
+        return _qmc;
+    }  // qmc()
+
+    // Run the regression checks of the engines against each other instead of a sweep
+    bool self_check() const {
+        return _self_check;
+    }  // self_check()
+
+    // The same options with terminal reactivity ratios r_L and r_G
+    Args with_ratios(double r_L, double r_G) const {
+        Args point(*this);
+        point._r_L = point._r_GL = r_L;
+        point._r_G = point._r_LG = r_G;
+        return point;
+    }  // with_ratios()
+
+    // The same options with replicate lengths drawn from another distribution
+    Args with_lengths(LengthDist lengths) const {
+        Args point(*this);
+        point._lengths = lengths;
+        return point;
+    }  // with_lengths()
+
+    // The same options at another (g_prob, fixed, dimers) point; --direct carries over
+    // only to fixed points, the only ones it can sample
+    Args at_point(double g_prob, bool fixed, bool dimers) const {
+        Args point(*this);
+        point._g_prob = g_prob;
+        point._fixed = fixed;
+        point._dimers = dimers;
+        point._direct = _direct && fixed;
+        return point;
+    }  // at_point()
 }; // Args
 
 
 static std::default_random_engine rng;
 
+// Number of G monomers placed by the fixed method (every index i < n * g_prob)
+// Input: n (int) - number of generated monomers
+//        g_prob (double) - fraction of G monomers
+int fixed_g_count(int n, double g_prob) {
+    return std::min(n, (int)std::ceil(n * g_prob));
+} // fixed_g_count()
+
 // Randomly generate polymer of length N from L and G monomers
 // Input: n (int) - length of polymer in monomers (degree of polymerization)
 //        g_prob (double) - probability of G monomer occuring at each position
@@ -108,10 +871,10 @@ std::string gen(int n,
     
     if(fixed) {
         std::vector<int> dist(n);
-        iota( dist.begin(), dist.end(), 1 );
+        iota( dist.begin(), dist.end(), 0 );
         std::shuffle(dist.begin(), dist.end(), rng);
 
-        for(int i = 0; i < n * g_prob; ++i) {
+        for(int i = 0; i < fixed_g_count(n, g_prob); ++i) {
             polymer[dist[i]] = 'G';
         } // for
     } else {
@@ -141,12 +904,16 @@ struct Stats {
     int LLs;
     int GLs;
     int LGs;
+    int Gs;     // monomer counts, for composition metrics
+    int Ls;
 }; // Stats
 
 // Calculate GG, LL, GL, and LG counts for a given polymer
 // Input: polymer (string) - polymer formed by G and L monomers
 Stats calc_stats(const std::string& polymer) {
-    Stats stats = {0, 0, 0, 0};
+    Stats stats = {0, 0, 0, 0, 0, 0};
+    stats.Gs = std::count(polymer.begin(), polymer.end(), 'G');
+    stats.Ls = polymer.size() - stats.Gs;
     for(int i = 0; i < polymer.size() - 1; ++i) {
         if(polymer[i] == 'G' && polymer[i + 1] == 'G') {
             stats.GGs++;
@@ -161,6 +928,605 @@ Stats calc_stats(const std::string& polymer) {
     return stats;
 } // calc_stats()
 
+// L/G polymer packed one monomer per bit (1 = G), position i at bit i % 64 of word i / 64
+// Buffers are reused across replicates, so regenerating a chain does not allocate
+struct Packed {
+    int n = 0;
+    std::vector<uint64_t> words;
+
+    // Reset to n L monomers, keeping the existing allocation
+    void clear(int size) {
+        n = size;
+        words.assign((size + 63) / 64, 0);
+    }  // clear()
+
+    bool get(int i) const {
+        return (words[i >> 6] >> (i & 63)) & 1;
+    }  // get()
+
+    void set(int i) {
+        words[i >> 6] |= 1ull << (i & 63);
+    }  // set()
+
+    // Mark monomers [begin, end) as G
+    void set_run(int begin, int end) {
+        while(begin < end) {
+            int bit = begin & 63;
+            int len = std::min(end - begin, 64 - bit);
+            uint64_t mask = (len == 64) ? ~0ull : ((1ull << len) - 1) << bit;
+            words[begin >> 6] |= mask;
+            begin += len;
+        } // while
+    }  // set_run()
+}; // Packed
+
+// Count GG, LL, GL and LG dyads at bonds [from, to) of n packed monomers, 64 per step
+// (bond i joins monomers i and i + 1)
+// Input: words (uint64_t *) - monomers packed as in Packed
+//        n (int) - number of monomers
+//        from, to (int) - range of bonds to count, 0 <= from <= to <= n - 1
+Stats count_dyads(const uint64_t * words, int n, int from, int to) {
+    Stats stats = {0, 0, 0, 0, 0, 0};
+    int num_words = (n + 63) / 64;
+    for(int w = from >> 6; w * 64 < to; ++w) {
+        uint64_t first = words[w];
+        uint64_t second = first >> 1;
+        if(w + 1 < num_words) second |= words[w + 1] << 63;
+
+        int valid = std::min(64, to - w * 64);
+        uint64_t mask = (valid == 64) ? ~0ull : (1ull << valid) - 1;
+        if(w == (from >> 6)) mask &= ~0ull << (from & 63);
+
+        stats.GGs += __builtin_popcountll(first & second & mask);
+        stats.GLs += __builtin_popcountll(first & ~second & mask);
+        stats.LGs += __builtin_popcountll(~first & second & mask);
+    } // for
+    stats.LLs = (to - from) - stats.GGs - stats.GLs - stats.LGs;
+    return stats;
+} // count_dyads()
+
+// Calculate GG, LL, GL, and LG counts for a packed polymer
+// Input: polymer (Packed) - polymer formed by G (1) and L (0) monomers
+//        cyclic (bool) - also count the dyad closing the ring (last monomer to first)
+//        width (int) - monomers per generated unit (2 for dimers); like the exact engines,
+//                      a ring of a single unit has no closing dyad
+Stats calc_stats(const Packed& polymer, bool cyclic = false, int width = 1) {
+    Stats stats = count_dyads(polymer.words.data(), polymer.n, 0, std::max(polymer.n - 1, 0));
+    for(uint64_t word : polymer.words) {
+        stats.Gs += __builtin_popcountll(word);
+    } // for
+    stats.Ls = polymer.n - stats.Gs;
+    if(cyclic && polymer.n >= 2 * width) {
+        bool last = polymer.get(polymer.n - 1);
+        bool first = polymer.get(0);
+        if(last && first) stats.GGs++;
+        else if(last) stats.GLs++;
+        else if(first) stats.LGs++;
+        else stats.LLs++;
+    } // if
+    return stats;
+} // calc_stats()
+
+// Count the k-mers (runs of k consecutive monomers) of a packed polymer
+// A k-mer is read as a k-bit code with its first monomer in bit 0. Short k-mers are
+// counted 64 positions at a time: the word of positions holding each code is built by
+// AND-ing the word shifted by j (or its complement) for j < k, then popcounted, which
+// costs about 3 * 2^k operations per word. Longer ones are read position by position as
+// a shift and mask of a 128-bit window over two words, with neighbouring positions sent
+// to four interleaved histograms so repeated codes do not serialize on one counter.
+// Input: polymer (Packed) - polymer formed by G (1) and L (0) monomers
+//        k (int) - k-mer length, 1 to 8
+//        cyclic (bool) - also count the k - 1 k-mers that wrap around the ring
+//        counts (vector<int>) - output, 2^k counts indexed by code
+// Output: number of k-mers counted
+int count_kmers(const Packed& polymer, int k, bool cyclic, std::vector<int>& counts) {
+    const int codes = 1 << k;
+    const uint64_t mask = codes - 1;
+    const int n = polymer.n;
+    const int num_words = polymer.words.size();
+    int linear = std::max(n - k + 1, 0);
+
+    counts.assign(codes, 0);
+    if(k <= 4) {
+        uint64_t match[16];
+        for(int w = 0; w * 64 < linear; ++w) {
+            unsigned __int128 window = polymer.words[w];
+            if(w + 1 < num_words) window |= (unsigned __int128)polymer.words[w + 1] << 64;
+            int end = std::min(64, linear - w * 64);
+            match[0] = (end == 64) ? ~0ull : (1ull << end) - 1;
+            for(int j = 0; j < k; ++j) {
+                uint64_t bits = (uint64_t)(window >> j);
+                for(int c = (1 << j) - 1; c >= 0; --c) {
+                    match[c | 1 << j] = match[c] & bits;
+                    match[c] &= ~bits;
+                } // for
+            } // for
+            for(int c = 0; c < codes; ++c) {
+                counts[c] += __builtin_popcountll(match[c]);
+            } // for
+        } // for
+    } else {
+        static thread_local std::vector<int> hist;
+        hist.assign(4 * codes, 0);
+        for(int w = 0; w * 64 < linear; ++w) {
+            unsigned __int128 window = polymer.words[w];
+            if(w + 1 < num_words) window |= (unsigned __int128)polymer.words[w + 1] << 64;
+            int end = std::min(64, linear - w * 64);
+            for(int b = 0; b < end; ++b) {
+                hist[(b & 3) * codes + (int)((uint64_t)(window >> b) & mask)]++;
+            } // for
+        } // for
+        for(int h = 0; h < 4; ++h) {
+            for(int c = 0; c < codes; ++c) {
+                counts[c] += hist[h * codes + c];
+            } // for
+        } // for
+    } // if...else
+
+    if(!cyclic || n < k) return linear;
+    for(int i = linear; i < n; ++i) {
+        int code = 0;
+        for(int j = 0; j < k; ++j) {
+            code |= polymer.get((i + j) % n) << j;
+        } // for
+        counts[code]++;
+    } // for
+    return n;
+} // count_kmers()
+
+// Run (block) length histograms of L and G runs
+// Bin l - 1 counts runs of l units; the last bin collects every run of max_len or more.
+struct RunHistogram {
+    std::vector<long long> L;
+    std::vector<long long> G;
+
+    RunHistogram(int max_len = 0) : L(max_len, 0), G(max_len, 0) {}
+
+    void add(bool is_G, int len) {
+        std::vector<long long>& bins = is_G ? G : L;
+        bins[std::min(len, (int)bins.size()) - 1]++;
+    }  // add()
+
+    void merge(const RunHistogram& other) {
+        for(size_t i = 0; i < L.size(); ++i) {
+            L[i] += other.L[i];
+            G[i] += other.G[i];
+        } // for
+    }  // merge()
+}; // RunHistogram
+
+// Add the runs of a packed polymer to a histogram
+// Run starts are the set bits of the word XOR-ed with itself shifted by one monomer,
+// found with count-trailing-zeros, so a word costs one step per run instead of 64.
+// Input: polymer (Packed) - polymer formed by G (1) and L (0) monomers
+//        cyclic (bool) - join the last and first runs when they are of the same type
+//        hist (RunHistogram) - histogram to add to
+void count_runs(const Packed& polymer, bool cyclic, RunHistogram& hist) {
+    const int n = polymer.n;
+    if(n == 0) return;
+
+    int start = 0;          // start of the open run
+    int first_len = -1;     // the first run is held back in case the ring joins it to the last
+    uint64_t carry = polymer.words[0] & 1;  // monomer before the word, so bit 0 is no start
+    for(int w = 0; w * 64 < n; ++w) {
+        uint64_t word = polymer.words[w];
+        uint64_t starts = word ^ (word << 1 | carry);
+        carry = word >> 63;
+        if((w + 1) * 64 > n) starts &= (1ull << (n - w * 64)) - 1;
+        while(starts) {
+            int pos = w * 64 + __builtin_ctzll(starts);
+            starts &= starts - 1;
+            if(first_len < 0) first_len = pos;
+            else hist.add(polymer.get(start), pos - start);
+            start = pos;
+        } // while
+    } // for
+
+    bool first_G = polymer.get(0);
+    bool last_G = polymer.get(start);
+    if(first_len < 0) {
+        // a single run
+        hist.add(first_G, n);
+    } else if(cyclic && first_G == last_G) {
+        hist.add(first_G, first_len + n - start);
+    } else {
+        hist.add(first_G, first_len);
+        hist.add(last_G, n - start);
+    } // if...else
+} // count_runs()
+
+// Packed version of gen() (same arguments and distribution); with dimers an odd
+// trailing monomer is dropped, so the chain has 2*(n/2) monomers as in gen()
+// Input: engine (default_random_engine) - random source
+//        polymer (Packed) - output, overwritten
+void gen(int n, 
+         double g_prob, 
+         bool fixed, 
+         bool dimers, 
+         std::default_random_engine& engine, 
+         Packed& polymer) {
+    int width = dimers ? 2 : 1;
+    int m = n / width;
+    polymer.clear(m * width);
+
+    if(fixed) {
+        // partial Fisher-Yates: only the first k shuffled positions are needed
+        static thread_local std::vector<int> dist;
+        dist.resize(m);
+        iota(dist.begin(), dist.end(), 0);
+        int k = fixed_g_count(m, g_prob);
+        for(int i = 0; i < k; ++i) {
+            std::uniform_int_distribution<int> pick(i, m - 1);
+            std::swap(dist[i], dist[pick(engine)]);
+            polymer.set_run(dist[i] * width, dist[i] * width + width);
+        } // for
+    } else {
+        std::uniform_real_distribution<double> dist(0.0, 1.0);
+        for(int i = 0; i < m; ++i) {
+            if(dist(engine) < g_prob) {
+                polymer.set_run(i * width, i * width + width);
+            } // if
+        } // for
+    } // if...else
+} // gen()
+
+// Walker alias table for O(1) draws from a fixed discrete distribution
+class AliasTable {
+private:
+    std::vector<double> _prob;
+    std::vector<int> _alias;
+
+public:
+    AliasTable() {}
+
+    // Build the table with Vose's method in O(size)
+    // Input: weights (vector<double>) - non-negative, unnormalized weights
+    explicit AliasTable(const std::vector<double>& weights) {
+        int size = weights.size();
+        _prob.resize(size);
+        _alias.resize(size);
+
+        double total = std::accumulate(weights.begin(), weights.end(), 0.0);
+        std::vector<int> small, large;
+        for(int i = 0; i < size; ++i) {
+            _prob[i] = weights[i] * size / total;
+            _alias[i] = i;
+            if(_prob[i] < 1) small.push_back(i);
+            else large.push_back(i);
+        } // for
+
+        while(!small.empty() && !large.empty()) {
+            int s = small.back();
+            int l = large.back();
+            small.pop_back();
+            _alias[s] = l;
+            _prob[l] -= 1 - _prob[s];
+            if(_prob[l] < 1) {
+                large.pop_back();
+                small.push_back(l);
+            } // if
+        } // while
+        // leftovers are 1 up to rounding
+        for(int i : small) _prob[i] = 1;
+        for(int i : large) _prob[i] = 1;
+    }  // AliasTable()
+
+    // Draw an index with probability proportional to its weight
+    // A single 30-bit uniform (one call of the default engine) picks both the column
+    // and the coin, which is plenty of resolution for the tables built here. The coin
+    // is unpredictable, so it selects between i and its alias with a mask instead of a
+    // branch that would mispredict on most draws.
+    template <typename Engine>
+    int operator()(Engine& engine) const {
+        double u = std::generate_canonical<double, 30>(engine) * _prob.size();
+        int i = std::min((int)u, (int)_prob.size() - 1);
+        int use_alias = -(int)(u - i >= _prob[i]);
+        return i ^ ((i ^ _alias[i]) & use_alias);
+    }  // operator()
+
+    int size() const {
+        return _prob.size();
+    }  // size()
+}; // AliasTable
+
+// Randomly generate a ring-opening polymer of length n from a mix of LL, GG, LG and GL dimers
+// Each dimer is drawn as its 2-bit code (bit 0 first unit, bit 1 second unit, 1 = G),
+// which is already the packed pair of monomers, so 32 dimers fill a word without an
+// expansion pass. An odd trailing monomer is dropped as in gen().
+// Input: n (int) - length of polymer in monomers (degree of polymerization)
+//        types (AliasTable) - weights of the codes 0 = LL, 1 = GL, 2 = LG, 3 = GG
+//        engine (default_random_engine) - random source
+//        polymer (Packed) - output, overwritten
+void gen_heterodimers(int n, 
+                      const AliasTable& types, 
+                      std::default_random_engine& engine, 
+                      Packed& polymer) {
+    int m = n / 2;
+    polymer.clear(2 * m);
+    for(int j = 0; j < m; ++j) {
+        polymer.words[j >> 5] |= (uint64_t)types(engine) << (2 * (j & 31));
+    } // for
+} // gen_heterodimers()
+
+// Run-length description of a Markov copolymerization model
+// A run of L's starts after a G, so its second unit is added to a ...GL end and every
+// later one to a ...LL end; in the penultimate model those probabilities differ.
+// For a penultimate-unit model with feed fraction f_G and reactivity ratios
+// r_xL = k_xLL / k_xLG, r_xG = k_xGG / k_xGL (x = penultimate unit):
+//   P(L after xL) = r_xL f_L / (r_xL f_L + f_G),  P(G after xG) = r_xG f_G / (r_xG f_G + f_L)
+// The terminal model is the special case r_GL = r_LL and r_LG = r_GG.
+struct RunModel {
+    double p_L_first;  // P(L after GL)
+    double p_L_stay;   // P(L after LL)
+    double p_G_first;  // P(G after LG)
+    double p_G_stay;   // P(G after GG)
+    double p_start_G;  // probability the chain starts with a G run
+
+    // Input: g_prob (double) - G fraction of the feed
+    //        r_LL, r_GL, r_GG, r_LG (double) - reactivity ratios, named penultimate unit first
+    RunModel(double g_prob, double r_LL, double r_GL, double r_GG, double r_LG) {
+        double f_G = g_prob;
+        double f_L = 1 - g_prob;
+        auto p_L = [&](double r) { return (r * f_L + f_G > 0) ? r * f_L / (r * f_L + f_G) : 0; };
+        auto p_G = [&](double r) { return (r * f_G + f_L > 0) ? r * f_G / (r * f_G + f_L) : 0; };
+        p_L_first = p_L(r_GL);
+        p_L_stay = p_L(r_LL);
+        p_G_first = p_G(r_LG);
+        p_G_stay = p_G(r_GG);
+
+        // start on the copolymer composition: the share of monomers that sit in G runs
+        double L_mean = (p_L_stay < 1) ? 1 + p_L_first / (1 - p_L_stay) : INFINITY;
+        double G_mean = (p_G_stay < 1) ? 1 + p_G_first / (1 - p_G_stay) : INFINITY;
+        if(std::isinf(L_mean) && std::isinf(G_mean)) p_start_G = f_G;
+        else if(std::isinf(L_mean)) p_start_G = 0;
+        else if(std::isinf(G_mean)) p_start_G = 1;
+        else p_start_G = G_mean / (L_mean + G_mean);
+    }  // RunModel()
+}; // RunModel
+
+// Lengths of runs whose second unit joins with probability p_first and every later
+// unit with probability p_stay
+// Drawn as at most one uniform plus one geometric variate per run instead of one
+// draw per monomer
+class RunLength {
+private:
+    double _p_first;
+    double _p_stay;
+    std::geometric_distribution<int> _extra;
+    std::uniform_real_distribution<double> _uniform;
+
+public:
+    RunLength(double p_first, double p_stay)
+        : _p_first(p_first), 
+          _p_stay(p_stay), 
+          _extra(std::min(std::max(1 - p_stay, 1e-300), 1.0)), 
+          _uniform(0.0, 1.0) {}
+
+    // Input: max_len (int) - monomers left in the chain, the run is capped there
+    int operator()(int max_len, std::default_random_engine& engine) {
+        int len = 1;
+        if(_p_first != _p_stay) {
+            // penultimate step first, then the run continues from an xx end
+            if(_p_first <= 0 || _uniform(engine) >= _p_first) return 1;
+            len = 2;
+        } // if
+        if(_p_stay >= 1) return max_len;
+        if(_p_stay > 0) len += _extra(engine);
+        return std::min(len, max_len);
+    }  // operator()
+
+    // Units added to a run that already holds len units (may be none)
+    // Input: len (int) - current run length, at least 1
+    //        max_len (int) - units left before the run is capped
+    int extend(int len, int max_len, std::default_random_engine& engine) {
+        double p_join = (len >= 2) ? _p_stay : _p_first;
+        if(p_join <= 0 || _uniform(engine) >= p_join) return 0;
+        if(_p_stay >= 1) return max_len;
+        int extra = 1;
+        if(_p_stay > 0) extra += _extra(engine);
+        return std::min(extra, max_len);
+    }  // extend()
+}; // RunLength
+
+// Randomly generate polymer of length n from a terminal or penultimate copolymerization model
+// Whole runs are sampled at once from their (shifted) geometric length distribution
+// Input: n (int) - length of polymer in monomers (degree of polymerization)
+//        model (RunModel) - transition probabilities
+//        dimers (bool) - generate with dimers (true - ring-opening, false - polycondensation)
+//        engine (default_random_engine) - random source
+//        polymer (Packed) - output, overwritten
+void gen_markov(int n, 
+                const RunModel& model, 
+                bool dimers, 
+                std::default_random_engine& engine, 
+                Packed& polymer) {
+    int width = dimers ? 2 : 1;
+    int m = n / width;
+    polymer.clear(m * width);
+
+    RunLength L_run(model.p_L_first, model.p_L_stay);
+    RunLength G_run(model.p_G_first, model.p_G_stay);
+
+    std::uniform_real_distribution<double> dist(0.0, 1.0);
+    bool is_G = dist(engine) < model.p_start_G;
+    for(int pos = 0; pos < m; is_G = !is_G) {
+        int len = is_G ? G_run(m - pos, engine) : L_run(m - pos, engine);
+        if(is_G) polymer.set_run(pos * width, (pos + len) * width);
+        pos += len;
+    } // for
+} // gen_markov()
+
+// Run-length model of the chain statistics selected in args at G feed fraction g_prob
+// (bernoulli is the terminal model with all ratios 1)
+RunModel run_model(const Args& args, double g_prob) {
+    switch(args.model()) {
+        case Model::terminal:
+            return RunModel(g_prob, args.r_L(), args.r_L(), args.r_G(), args.r_G());
+        case Model::penultimate:
+            return RunModel(g_prob, args.r_L(), args.r_GL(), args.r_G(), args.r_LG());
+        default:
+            return RunModel(g_prob, 1, 1, 1, 1);
+    } // switch
+} // run_model()
+
+// Feed composition profile along the chain for gradient copolymers
+// The chain is split into segments of constant feed, each with its own run-length model.
+// Without a profile table the feed drifts with conversion as in a batch reactor: the
+// Skeist equation df/dX = (f - F) / (1 - X), with F the instantaneous copolymer
+// composition of the model at feed f, is integrated from the initial feed g_prob to
+// --conversion. Chains are taken to grow over the whole batch (living polymerization),
+// so the unit at fraction t of a chain was added at conversion t * X.
+// A profile table holds "position g_prob" rows: the chain fraction where a segment
+// starts (the first one at 0, increasing) and its G feed fraction; # starts a comment.
+struct Gradient {
+    std::vector<double> starts;     // chain fraction where each segment begins
+    std::vector<RunModel> models;   // run-length model of each segment
+
+    // Input: args (Args) - generator options; the profile is empty without --gradient
+    Gradient(const Args& args) {
+        if(!args.gradient()) return;
+
+        if(!args.gradient_file().empty()) {
+            std::ifstream in(args.gradient_file());
+            if(!in) {
+                std::cerr << "Error: cannot read " << args.gradient_file() << "\n";
+                exit(1);
+            } // if
+            std::string line;
+            while(std::getline(in, line)) {
+                line = line.substr(0, line.find('#'));
+                if(line.find_first_not_of(" \t\r") == std::string::npos) continue;
+                std::istringstream row(line);
+                double start = -1, g_prob = -1;
+                row >> start >> g_prob;
+                bool in_order = starts.empty() ? start == 0 : start > starts.back();
+                if(!row || !in_order || start >= 1 || g_prob < 0 || g_prob > 1) {
+                    std::cerr << "Error: bad gradient profile row: " << line << "\n";
+                    exit(1);
+                } // if
+                starts.push_back(start);
+                models.push_back(run_model(args, g_prob));
+            } // while
+            if(starts.empty()) {
+                std::cerr << "Error: empty gradient profile " << args.gradient_file() << "\n";
+                exit(1);
+            } // if
+            return;
+        } // if
+
+        const int segments = 32;
+        const int steps = 16;   // RK4 steps per half segment
+        const double X_end = args.conversion();
+        auto drift = [&](double X, double f) {
+            f = std::min(std::max(f, 0.0), 1.0);
+            return (f - run_model(args, f).p_start_G) / (1 - X);
+        };
+        double f = args.g_prob();
+        double X = 0;
+        double h = X_end / segments / 2 / steps;
+        auto advance = [&]() {
+            for(int i = 0; i < steps; ++i) {
+                double k1 = drift(X, f);
+                double k2 = drift(X + h / 2, f + h / 2 * k1);
+                double k3 = drift(X + h / 2, f + h / 2 * k2);
+                double k4 = drift(X + h, f + h * k3);
+                f += h / 6 * (k1 + 2 * k2 + 2 * k3 + k4);
+                X += h;
+            } // for
+        };
+        for(int s = 0; s < segments; ++s) {
+            // each segment takes the feed at its midpoint conversion
+            advance();
+            starts.push_back((double)s / segments);
+            models.push_back(run_model(args, std::min(std::max(f, 0.0), 1.0)));
+            advance();
+        } // for
+    }  // Gradient()
+}; // Gradient
+
+// Randomly generate a gradient polymer of length n from a feed profile
+// Runs are sampled whole as in gen_markov(), capped at segment boundaries; a run that
+// reaches a boundary is continued (or ended) with the next segment's probabilities.
+// Input: n (int) - length of polymer in monomers (degree of polymerization)
+//        gradient (Gradient) - segment models along the chain
+//        dimers (bool) - generate with dimers (true - ring-opening, false - polycondensation)
+//        engine (default_random_engine) - random source
+//        polymer (Packed) - output, overwritten
+void gen_gradient(int n, 
+                  const Gradient& gradient, 
+                  bool dimers, 
+                  std::default_random_engine& engine, 
+                  Packed& polymer) {
+    int width = dimers ? 2 : 1;
+    int m = n / width;
+    polymer.clear(m * width);
+
+    int segments = gradient.models.size();
+    auto segment_end = [&](int s) {
+        return (s + 1 < segments) ? (int)std::lround(gradient.starts[s + 1] * m) : m;
+    };
+
+    std::uniform_real_distribution<double> dist(0.0, 1.0);
+    bool is_G = dist(engine) < gradient.models[0].p_start_G;
+    int run = 0;    // units already in the current run
+    for(int pos = 0, s = 0; pos < m;) {
+        int end = segment_end(s);
+        if(pos >= end) {
+            ++s;
+            continue;
+        } // if
+        const RunModel& model = gradient.models[s];
+        RunLength sampler = is_G ? RunLength(model.p_G_first, model.p_G_stay) 
+                                 : RunLength(model.p_L_first, model.p_L_stay);
+        int len = run ? sampler.extend(run, end - pos, engine) : sampler(end - pos, engine);
+        if(is_G) polymer.set_run(pos * width, (pos + len) * width);
+        pos += len;
+        run += len;
+        if(len == 0 || pos < end) {
+            is_G = !is_G;
+            run = 0;
+        } // if
+    } // for
+} // gen_gradient()
+
+// Tables gen_polymer() needs, built once per run from the options
+struct ChainTables {
+    Gradient gradient;          // feed profile for --gradient
+    AliasTable dimer_types;     // dimer codes for --dimer_probs
+
+    ChainTables(const Args& args) : gradient(args) {
+        const std::vector<double>& p = args.dimer_probs();
+        // --dimer_probs is given as LL,GG,LG,GL; the table is indexed by 2-bit code
+        if(!p.empty()) dimer_types = AliasTable({p[0], p[3], p[2], p[1]});
+    }  // ChainTables()
+}; // ChainTables
+
+// Generate one polymer of length n for the model selected in args
+// Input: tables (ChainTables) - profile and dimer tables built from args
+void gen_polymer(const Args& args, 
+                 const ChainTables& tables, 
+                 int n, 
+                 std::default_random_engine& engine, 
+                 Packed& polymer) {
+    if(args.gradient()) {
+        gen_gradient(n, tables.gradient, args.dimers(), engine, polymer);
+        return;
+    } // if
+    if(!args.dimer_probs().empty()) {
+        gen_heterodimers(n, tables.dimer_types, engine, polymer);
+        return;
+    } // if
+    switch(args.model()) {
+        case Model::bernoulli:
+            gen(n, args.g_prob(), args.fixed(), args.dimers(), engine, polymer);
+            break;
+        case Model::terminal:
+        case Model::penultimate:
+            gen_markov(n, run_model(args, args.g_prob()), args.dimers(), engine, polymer);
+            break;
+    } // switch
+} // gen_polymer()
+
 double mean(const std::vector<double>& data) {
     double sum = 0;
     for(int i = 0; i < data.size(); ++i) {
@@ -195,74 +1561,3438 @@ std::vector<double> calc_L_L_or_L_G(std::vector<int>& top,
     return L_L_or_L_Gs;
 } // calc_L_L_or_L_G()
 
-int main(int argc, char *argv[]) {
-    rng.seed(std::chrono::system_clock::now().time_since_epoch().count());
-    std::ios_base::sync_with_stdio(false);
+// Run body(i) for every i in [0, count) on a pool of worker threads
+// Items are handed out one at a time, so uneven work sizes still balance
+// Input: count (int) - number of independent work items
+//        threads (int) - number of worker threads
+//        body (F) - callable taking the item index
+template <typename F>
+void parallel_for(int count, int threads, F body) {
+    std::atomic<int> next(0);
+    std::vector<std::thread> workers;
+    int num_workers = std::max(1, std::min(threads, count));
+    for(int t = 0; t < num_workers; ++t) {
+        workers.emplace_back([&]() {
+            for(int i = next++; i < count; i = next++) {
+                body(i);
+            } // for
+        });
+    } // for
+    for(std::thread& worker : workers) {
+        worker.join();
+    } // for
+} // parallel_for()
 
-    Args args(argc, argv);
-    int N = 10000;
+// Running mean and sum of squared deviations of a stream of values
+// Accumulators of separate threads merge exactly (Chan et al.), so a block of replicates
+// can be reduced on its own and combined afterwards.
+struct Accumulator {
+    long long count = 0;
+    double mean = 0;
+    double m2 = 0;
 
-    std::vector<double> L_L_means;
-    std::vector<double> L_L_sems;
-    std::vector<double> L_G_means;
-    std::vector<double> L_G_sems;
+    void add(double x) {
+        count++;
+        double delta = x - mean;
+        mean += delta / count;
+        m2 += delta * (x - mean);
+    }  // add()
 
-    for(int n = 40; n <= 3000; n += 8) {
-        std::vector<int> LL_stats;
-        std::vector<int> LG_stats;
-        std::vector<int> GG_stats;
-        std::vector<int> GL_stats;
+    void merge(const Accumulator& other) {
+        if(other.count == 0) return;
+        long long total = count + other.count;
+        double delta = other.mean - mean;
+        mean += delta * other.count / total;
+        m2 += other.m2 + delta * delta * count * other.count / total;
+        count = total;
+    }  // merge()
 
-        for(int i = 0; i < N; ++i) {
-            std::string polymer = gen(n, args.g_prob(), args.fixed(), args.dimers());
-            Stats stats = calc_stats(polymer);
+    // Same estimator as sem(): population deviation over sqrt(N - 1)
+    double sem() const {
+        return (count > 1) ? sqrt(m2 / count) / sqrt(count - 1) : 0;
+    }  // sem()
+}; // Accumulator
+
+// Running means and co-moments of a stream of D-dimensional values
+// The multivariate form of Accumulator: one pass, and accumulators of separate threads
+// merge exactly, so full covariances come without keeping the replicates.
+template <int D>
+struct CoMoments {
+    long long count = 0;
+    std::array<double, D> mean = {};
+    std::array<std::array<double, D>, D> C = {};    // sum of products of deviations
 
-            LL_stats.push_back(stats.LLs);
-            LG_stats.push_back(stats.LGs);
-            GG_stats.push_back(stats.GGs);
-            GL_stats.push_back(stats.GLs);
+    void add(const std::array<double, D>& x) {
+        count++;
+        std::array<double, D> before;
+        for(int i = 0; i < D; ++i) {
+            before[i] = x[i] - mean[i];
+            mean[i] += before[i] / count;
         } // for
+        for(int i = 0; i < D; ++i) {
+            for(int j = 0; j < D; ++j) {
+                C[i][j] += before[i] * (x[j] - mean[j]);
+            } // for
+        } // for
+    }  // add()
 
-        std::vector<double> L_Ls = calc_L_L_or_L_G(LL_stats, LG_stats);
-        std::vector<double> L_Gs = calc_L_L_or_L_G(GG_stats, GL_stats);
-        
-        double L_L_mean = mean(L_Ls);
-        L_L_means.push_back(L_L_mean);
-        L_L_sems.push_back(sem(L_Ls, L_L_mean));
+    void merge(const CoMoments& other) {
+        if(other.count == 0) return;
+        long long total = count + other.count;
+        double scale = (double)count * other.count / total;
+        std::array<double, D> delta;
+        for(int i = 0; i < D; ++i) {
+            delta[i] = other.mean[i] - mean[i];
+        } // for
+        for(int i = 0; i < D; ++i) {
+            for(int j = 0; j < D; ++j) {
+                C[i][j] += other.C[i][j] + delta[i] * delta[j] * scale;
+            } // for
+            mean[i] += delta[i] * other.count / total;
+        } // for
+        count = total;
+    }  // merge()
 
-        double L_G_mean = mean(L_Gs);
-        L_G_means.push_back(L_G_mean);
-        L_G_sems.push_back(sem(L_Gs, L_G_mean));
-    } // for
+    // Covariance of the means of i and j; the diagonal is the square of sem()
+    double mean_covariance(int i, int j) const {
+        return (count > 1) ? C[i][j] / count / (count - 1) : 0;
+    }  // mean_covariance()
 
-    std::ofstream file;
-    
-    std::string append = "";
-    if(args.fixed()) append += "_f";
-    if(args.dimers()) append += "_d";
+    double correlation(int i, int j) const {
+        double norm = sqrt(C[i][i] * C[j][j]);
+        return (norm > 0) ? C[i][j] / norm : 0;
+    }  // correlation()
+}; // CoMoments
 
-    std::cout << L_L_means.size() << std::endl;
-    file.open("data/L_L_means" + append + ".txt");
-    for(int i = 0; i < L_L_means.size(); ++i) {
-        file << L_L_means[i] << "\n";
-    } // for
-    file.close();
+// Quantities tracked by --covariance, in output order
+const int covariance_size = 6;
+const char * const covariance_names[covariance_size] = {"GG", "GL", "LG", "LL", "L_L", "L_G"};
 
-    file.open("data/L_L_sems" + append + ".txt");
-    for(int i = 0; i < L_L_sems.size(); ++i) {
-        file << L_L_sems[i] << "\n";
-    } // for
-    file.close();
+std::array<double, covariance_size> covariance_values(const Stats& s) {
+    // same clamp as calc_L_L_or_L_G()
+    return {(double)s.GGs, (double)s.GLs, (double)s.LGs, (double)s.LLs, 
+            (double)s.LLs / std::max(s.LGs, 1) + 1, (double)s.GGs / std::max(s.GLs, 1) + 1};
+} // covariance_values()
 
-    file.open("data/L_G_means" + append + ".txt");
-    for(int i = 0; i < L_G_means.size(); ++i) {
-        file << L_G_means[i] << "\n";
-    } // for
-    file.close();
+// Likelihood-ratio (score function) derivatives of E[L_L] and E[L_G] by g_prob
+// A Bernoulli chain of a L and b G units has probability g^b (1 - g)^a, so its score is
+// S = b / g - a / (1 - g) and dE[f]/dg = E[f S] = Cov(f, S), as E[S] = 0. The covariance
+// is estimated as mean(f S) - mean(f) mean(S) from co-moments of (L_L, L_G, S, L_L S, L_G S),
+// accumulated in the same pass as the values; the delta method gives its standard error.
+const int score_size = 5;
 
-    file.open("data/L_G_sems" + append + ".txt");
-    for(int i = 0; i < L_G_sems.size(); ++i) {
-        file << L_G_sems[i] << "\n";
+// Input: s (Stats) - dyad and monomer counts of one replicate
+//        g_prob (double) - G probability it was generated with
+//        dimers (bool) - units are dimers (two monomers each)
+std::array<double, score_size> score_values(const Stats& s, double g_prob, bool dimers) {
+    int width = dimers ? 2 : 1;
+    double score = (double)(s.Gs / width) / g_prob - (double)(s.Ls / width) / (1 - g_prob);
+    // same clamp as calc_L_L_or_L_G()
+    double L_L = (double)s.LLs / std::max(s.LGs, 1) + 1;
+    double L_G = (double)s.GGs / std::max(s.GLs, 1) + 1;
+    return {L_L, L_G, score, L_L * score, L_G * score};
+} // score_values()
+
+// dE[f]/dg_prob and its standard error for f = L_L (0) or L_G (1)
+void score_derivative(const CoMoments<score_size>& moments, int f, double& value, double& sem) {
+    const int S = 2;
+    const int fS = 3 + f;
+    value = moments.mean[fS] - moments.mean[f] * moments.mean[S];
+    // gradient of the estimate with respect to the means of f S, f and S
+    const int index[3] = {fS, f, S};
+    const double grad[3] = {1, -moments.mean[S], -moments.mean[f]};
+    double var = 0;
+    for(int i = 0; i < 3; ++i) {
+        for(int j = 0; j < 3; ++j) {
+            var += grad[i] * grad[j] * moments.mean_covariance(index[i], index[j]);
+        } // for
+    } // for
+    sem = sqrt(std::max(var, 0.0));
+} // score_derivative()
+
+// Per-replicate quantities that --metrics can report, each a function of one replicate's
+// Stats evaluated in the same pass as L_L and L_G. Ratios clamp zero denominators to 1
+// like calc_L_L_or_L_G(). To add a metric, add a row.
+struct Metric {
+    const char * name;
+    double (*value)(const Stats&);
+}; // Metric
+
+const Metric metric_registry[] = {
+    // mean L and G block lengths
+    {"L_L", [](const Stats& s) { return (double)s.LLs / std::max(s.LGs, 1) + 1; }},
+    {"L_G", [](const Stats& s) { return (double)s.GGs / std::max(s.GLs, 1) + 1; }},
+    // G-G to G-L dyad ratio
+    {"R_c", [](const Stats& s) { return (double)s.GGs / std::max(s.GLs, 1); }},
+    // L/G composition ratio and G fraction
+    {"LG_ratio", [](const Stats& s) { return (double)s.Ls / std::max(s.Gs, 1); }},
+    {"F_G", [](const Stats& s) { return (double)s.Gs / std::max(s.Gs + s.Ls, 1); }},
+    // randomness character B = P(G after L) + P(L after G): 1 random, 2 alternating, 0 blocky
+    {"B", [](const Stats& s) { 
+        return (double)s.LGs / std::max(s.LLs + s.LGs, 1) + (double)s.GLs / std::max(s.GGs + s.GLs, 1); }},
+    // raw dyad counts
+    {"LL", [](const Stats& s) { return (double)s.LLs; }},
+    {"LG", [](const Stats& s) { return (double)s.LGs; }},
+    {"GL", [](const Stats& s) { return (double)s.GLs; }},
+    {"GG", [](const Stats& s) { return (double)s.GGs; }},
+}; // metric_registry[]
+
+// Look up registry metrics by name
+// Input: names (vector<string>) - metric names from --metrics
+std::vector<const Metric*> find_metrics(const std::vector<std::string>& names) {
+    std::vector<const Metric*> metrics;
+    for(const std::string& name : names) {
+        const Metric* found = nullptr;
+        for(const Metric& metric : metric_registry) {
+            if(name == metric.name) found = &metric;
+        } // for
+        if(!found) {
+            std::cerr << "Error: unknown metric " << name << " (known:";
+            for(const Metric& metric : metric_registry) std::cerr << " " << metric.name;
+            std::cerr << ")\n";
+            exit(1);
+        } // if
+        metrics.push_back(found);
+    } // for
+    return metrics;
+} // find_metrics()
+
+// Mergeable quantile sketch (merging t-digest)
+// Values are buffered and periodically folded into at most about compression centroids,
+// which are small near the tails (scale function k(q) = compression / 2pi * asin(2q - 1))
+// so extreme quantiles stay accurate. Memory is fixed; digests from separate threads
+// merge by folding one's centroids into the other.
+class TDigest {
+private:
+    struct Centroid {
+        double mean;
+        double weight;
+    }; // Centroid
+
+    double _compression;
+    std::vector<Centroid> _centroids;
+    std::vector<Centroid> _buffer;
+    double _min;
+    double _max;
+
+    // Fold the buffer into the centroids
+    void flush() {
+        if(_buffer.empty()) return;
+        _buffer.insert(_buffer.end(), _centroids.begin(), _centroids.end());
+        std::sort(_buffer.begin(), _buffer.end(), [](const Centroid& a, const Centroid& b) {
+            return a.mean < b.mean;
+        });
+        double total = 0;
+        for(const Centroid& c : _buffer) total += c.weight;
+
+        auto k = [&](double q) {
+            return _compression / (2 * M_PI) * asin(2 * std::min(std::max(q, 0.0), 1.0) - 1);
+        };
+        _centroids.clear();
+        Centroid current = _buffer[0];
+        double done = 0;    // weight left of current
+        double k_low = k(0);
+        for(size_t i = 1; i < _buffer.size(); ++i) {
+            const Centroid& next = _buffer[i];
+            if(k((done + current.weight + next.weight) / total) - k_low <= 1) {
+                current.mean += (next.mean - current.mean) * next.weight / (current.weight + next.weight);
+                current.weight += next.weight;
+            } else {
+                _centroids.push_back(current);
+                done += current.weight;
+                k_low = k(done / total);
+                current = next;
+            } // if...else
+        } // for
+        _centroids.push_back(current);
+        _buffer.clear();
+    }  // flush()
+
+public:
+    explicit TDigest(double compression = 100) 
+        : _compression(compression), _min(INFINITY), _max(-INFINITY) {}
+
+    void add(double x, double weight = 1) {
+        _buffer.push_back({x, weight});
+        _min = std::min(_min, x);
+        _max = std::max(_max, x);
+        if(_buffer.size() >= 8 * _compression) flush();
+    }  // add()
+
+    void merge(TDigest& other) {
+        other.flush();
+        for(const Centroid& c : other._centroids) {
+            add(c.mean, c.weight);
+        } // for
+        _min = std::min(_min, other._min);
+        _max = std::max(_max, other._max);
+    }  // merge()
+
+    // Value at cumulative probability q, interpolated between centroid centers
+    double quantile(double q) {
+        flush();
+        if(_centroids.empty()) return NAN;
+        double total = 0;
+        for(const Centroid& c : _centroids) total += c.weight;
+        double target = q * total;
+
+        // each centroid's weight is centred on its mean; the extremes anchor the ends
+        double left = 0;
+        double prev_mean = _min;
+        double prev_pos = 0;
+        for(const Centroid& c : _centroids) {
+            double pos = left + c.weight / 2;
+            if(target < pos) {
+                double t = (pos > prev_pos) ? (target - prev_pos) / (pos - prev_pos) : 0;
+                return prev_mean + t * (c.mean - prev_mean);
+            } // if
+            prev_mean = c.mean;
+            prev_pos = pos;
+            left += c.weight;
+        } // for
+        double t = (total > prev_pos) ? (target - prev_pos) / (total - prev_pos) : 0;
+        return prev_mean + std::min(t, 1.0) * (_max - prev_mean);
+    }  // quantile()
+}; // TDigest
+
+// Fixed-memory histogram of values in [1, hi] on log-spaced bins
+// Bin i covers [hi^(i / bins), hi^((i + 1) / bins)); L_L and L_G of an n-mer lie in [1, n].
+class LogHistogram {
+private:
+    double _scale;
+    std::vector<long long> _counts;
+
+public:
+    LogHistogram(double hi = 2, int bins = 64) 
+        : _scale(bins / log(std::max(hi, 2.0))), _counts(bins, 0) {}
+
+    void add(double x) {
+        int bin = (int)(log(std::max(x, 1.0)) * _scale);
+        _counts[std::min(bin, (int)_counts.size() - 1)]++;
+    }  // add()
+
+    void merge(const LogHistogram& other) {
+        for(size_t i = 0; i < _counts.size(); ++i) {
+            _counts[i] += other._counts[i];
+        } // for
+    }  // merge()
+
+    const std::vector<long long>& counts() const {
+        return _counts;
+    }  // counts()
+}; // LogHistogram
+
+// SplitMix64 generator for bulk bootstrap indices
+// One call is a handful of integer operations and yields two 32-bit indices, several
+// times cheaper than the default engine plus a uniform_int_distribution per index.
+struct SplitMix64 {
+    uint64_t state;
+
+    explicit SplitMix64(uint64_t seed) : state(seed) {}
+
+    uint64_t operator()() {
+        uint64_t z = (state += 0x9e3779b97f4a7c15ull);
+        z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+        z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+        return z ^ (z >> 31);
+    }  // operator()
+}; // SplitMix64
+
+// Sobol direction numbers, generated on demand for any number of dimensions
+// Dimension 0 is the van der Corput sequence; dimension j >= 1 uses the j-th primitive
+// polynomial over GF(2) in order of degree, found by testing that x has order 2^s - 1
+// modulo the polynomial. The initial direction numbers m_1..m_s are odd values drawn
+// from a fixed SplitMix64 stream, not the tuned Joe-Kuo tables, so low-dimensional
+// projections are less even than the published ones but every dimension is still a
+// (0,1)-sequence in base 2.
+class Sobol {
+private:
+    std::vector<uint32_t> _directions;  // 32 per dimension
+    uint32_t _next_poly;                // next candidate polynomial (bit s = x^s)
+    std::vector<uint64_t> _factors;     // prime factors of 2^s - 1 for the current degree
+    int _degree;
+
+    // a * b modulo poly over GF(2), degrees below 32
+    static uint64_t mulmod(uint64_t a, uint64_t b, uint64_t poly, int degree) {
+        uint64_t result = 0;
+        for(; b; b >>= 1) {
+            if(b & 1) result ^= a;
+            a <<= 1;
+            if(a >> degree & 1) a ^= poly;
+        } // for
+        return result;
+    }  // mulmod()
+
+    // x^e modulo poly
+    static uint64_t powmod(uint64_t e, uint64_t poly, int degree) {
+        uint64_t result = 1;
+        uint64_t base = (degree > 1) ? 2 : 1;  // x mod (x + 1) = 1
+        for(; e; e >>= 1) {
+            if(e & 1) result = mulmod(result, base, poly, degree);
+            base = mulmod(base, base, poly, degree);
+        } // for
+        return result;
+    }  // powmod()
+
+    // next primitive polynomial, in order of degree
+    uint32_t next_primitive() {
+        for(;; _next_poly += 2) {
+            int degree = 31 - __builtin_clz(_next_poly);
+            if(degree != _degree) {
+                _degree = degree;
+                _factors.clear();
+                uint64_t order = (1ull << degree) - 1;
+                for(uint64_t q = 2; q * q <= order; ++q) {
+                    if(order % q) continue;
+                    _factors.push_back(q);
+                    while(order % q == 0) order /= q;
+                } // for
+                if(order > 1) _factors.push_back(order);
+            } // if
+            uint64_t order = (1ull << degree) - 1;
+            if(powmod(order, _next_poly, degree) != 1) continue;
+            bool primitive = true;
+            for(uint64_t q : _factors) {
+                if(powmod(order / q, _next_poly, degree) == 1) primitive = false;
+            } // for
+            if(primitive) {
+                _next_poly += 2;
+                return _next_poly - 2;
+            } // if
+        } // for
+    }  // next_primitive()
+
+public:
+    Sobol() : _next_poly(3), _degree(0) {}
+
+    int dims() const {
+        return _directions.size() / 32;
+    }  // dims()
+
+    // Extend the tables to at least dims dimensions (not thread safe)
+    void reserve(int dims) {
+        while(this->dims() < dims) {
+            int j = this->dims();
+            uint32_t v[32];
+            if(j == 0) {
+                for(int k = 0; k < 32; ++k) {
+                    v[k] = 1u << (31 - k);
+                } // for
+            } else {
+                uint32_t poly = next_primitive();
+                int s = 31 - __builtin_clz(poly);
+                SplitMix64 random(j);
+                uint64_t m[33];
+                for(int k = 1; k <= 32; ++k) {
+                    if(k <= s) {
+                        m[k] = (random() % (1ull << k)) | 1;
+                    } else {
+                        // m_k = 2 a_1 m_{k-1} ^ 4 a_2 m_{k-2} ^ ... ^ 2^s m_{k-s} ^ m_{k-s}
+                        m[k] = m[k - s] ^ (m[k - s] << s);
+                        for(int i = 1; i < s; ++i) {
+                            if(poly >> (s - i) & 1) m[k] ^= m[k - i] << i;
+                        } // for
+                    } // if...else
+                    v[k - 1] = (uint32_t)(m[k] << (32 - k));
+                } // for
+            } // if...else
+            _directions.insert(_directions.end(), v, v + 32);
+        } // while
+    }  // reserve()
+
+    // Direction number k (0 - most significant) of dimension j
+    uint32_t operator()(int j, int k) const {
+        return _directions[32 * j + k];
+    }  // operator()
+}; // Sobol
+
+inline uint32_t reverse_bits(uint32_t x) {
+    x = ((x >> 1) & 0x55555555u) | ((x & 0x55555555u) << 1);
+    x = ((x >> 2) & 0x33333333u) | ((x & 0x33333333u) << 2);
+    x = ((x >> 4) & 0x0f0f0f0fu) | ((x & 0x0f0f0f0fu) << 4);
+    x = ((x >> 8) & 0x00ff00ffu) | ((x & 0x00ff00ffu) << 8);
+    return (x >> 16) | (x << 16);
+} // reverse_bits()
+
+// Owen (nested uniform) scrambling of a 32-bit Sobol coordinate by hashing
+// (Laine-Karras permutation with Burley's constants): each bit is flipped by a hash of the
+// bits above it, so the scrambled points keep the net structure and are uniform.
+inline uint32_t owen_scramble(uint32_t x, uint32_t seed) {
+    x = reverse_bits(x);
+    x ^= x * 0x3d20adeau;
+    x += seed;
+    x *= (seed >> 16) | 1;
+    x ^= x * 0x05526c56u;
+    x ^= x * 0x53a22864u;
+    return reverse_bits(x);
+} // owen_scramble()
+
+// Unfixed bernoulli chain from a scrambled Sobol point instead of pseudo-random draws:
+// unit i is a G when coordinate i is below g_prob
+// Input: n, g_prob, dimers - same as gen() with fixed = false
+//        point (uint32_t*) - unscrambled Sobol coordinates, one per unit
+//        seeds (uint32_t*) - scrambling seed of each coordinate
+//        polymer (Packed) - output, overwritten
+void gen_qmc(int n, 
+             double g_prob, 
+             bool dimers, 
+             const uint32_t * point, 
+             const uint32_t * seeds, 
+             Packed& polymer) {
+    int width = dimers ? 2 : 1;
+    int m = n / width;
+    polymer.clear(m * width);
+    uint64_t threshold = (uint64_t)std::ldexp(g_prob, 32);
+    for(int i = 0; i < m; ++i) {
+        if(owen_scramble(point[i], seeds[i]) < threshold) {
+            polymer.set_run(i * width, i * width + width);
+        } // if
+    } // for
+} // gen_qmc()
+
+// Standard normal CDF and its inverse (by bisection, only needed a few times per n)
+double normal_cdf(double x) {
+    return 0.5 * erfc(-x / sqrt(2.0));
+} // normal_cdf()
+
+double normal_quantile(double p) {
+    double lo = -40, hi = 40;
+    for(int i = 0; i < 100; ++i) {
+        double mid = (lo + hi) / 2;
+        if(normal_cdf(mid) < p) lo = mid;
+        else hi = mid;
+    } // for
+    return (lo + hi) / 2;
+} // normal_quantile()
+
+// Percentile and BCa bootstrap intervals of a mean
+struct BootstrapCI {
+    double lo;
+    double hi;
+    double bca_lo;
+    double bca_hi;
+}; // BootstrapCI
+
+// Bootstrap confidence intervals for the means of paired per-replicate series
+// Every resample draws one set of N replicate indices (in batches, two indices per
+// generator call via a multiply-shift) shared by all series, so paired quantities such
+// as L_L and L_G are resampled together. Resamples are spread over the threads with
+// generators seeded from (seed, resample), so results do not depend on the thread count.
+// BCa uses the closed-form jackknife acceleration of a mean, a = sum d^3 / (6 (sum d^2)^1.5)
+// with d the deviations from the sample mean.
+// Input: series (vector<vector<double>>) - per-replicate values, all of the same length N
+//        resamples (int) - number of bootstrap resamples
+//        level (double) - confidence level, e.g. 0.95
+//        threads (int) - number of worker threads
+//        seed (uint64_t) - random seed
+std::vector<BootstrapCI> bootstrap_means(const std::vector<std::vector<double>>& series, 
+                                         int resamples, 
+                                         double level, 
+                                         int threads, 
+                                         uint64_t seed) {
+    const int count = series.size();
+    const int N = series[0].size();
+    std::vector<std::vector<double>> boot(count, std::vector<double>(resamples));
+
+    parallel_for(resamples, threads, [&](int r) {
+        SplitMix64 engine(SplitMix64(seed + r)());
+        const int batch = 256;
+        uint32_t index[batch];
+        std::vector<double> sums(count, 0.0);
+        for(int begin = 0; begin < N; begin += batch) {
+            int size = std::min(batch, N - begin);
+            for(int j = 0; j < size; j += 2) {
+                uint64_t bits = engine();
+                index[j] = (uint32_t)(((bits & 0xffffffffull) * N) >> 32);
+                index[j + 1] = (uint32_t)(((bits >> 32) * N) >> 32);
+            } // for
+            for(int s = 0; s < count; ++s) {
+                const double* values = series[s].data();
+                double sum = 0;
+                for(int j = 0; j < size; ++j) {
+                    sum += values[index[j]];
+                } // for
+                sums[s] += sum;
+            } // for
+        } // for
+        for(int s = 0; s < count; ++s) {
+            boot[s][r] = sums[s] / N;
+        } // for
+    });
+
+    const double alpha = (1 - level) / 2;
+    const double z_lo = normal_quantile(alpha);
+    const double z_hi = normal_quantile(1 - alpha);
+    std::vector<BootstrapCI> cis(count);
+    for(int s = 0; s < count; ++s) {
+        std::vector<double>& b = boot[s];
+        std::sort(b.begin(), b.end());
+        // linear interpolation between order statistics
+        auto percentile = [&](double q) {
+            double pos = std::min(std::max(q * (resamples - 1), 0.0), resamples - 1.0);
+            int i = std::min((int)pos, resamples - 2);
+            return b[i] + (pos - i) * (b[i + 1] - b[i]);
+        };
+
+        double m = mean(series[s]);
+        double d2 = 0, d3 = 0;
+        for(double x : series[s]) {
+            d2 += (x - m) * (x - m);
+            d3 += (x - m) * (x - m) * (x - m);
+        } // for
+        double a = (d2 > 0) ? d3 / (6 * pow(d2, 1.5)) : 0;
+        double below = std::lower_bound(b.begin(), b.end(), m) - b.begin();
+        double z0 = normal_quantile(std::min(std::max(below / resamples, 1.0 / (resamples + 1)), 
+                                             resamples / (resamples + 1.0)));
+        auto bca = [&](double z) {
+            return normal_cdf(z0 + (z0 + z) / (1 - a * (z0 + z)));
+        };
+
+        cis[s] = {percentile(alpha), percentile(1 - alpha), percentile(bca(z_lo)), percentile(bca(z_hi))};
+    } // for
+    return cis;
+} // bootstrap_means()
+
+// Shape of the L_L or L_G distribution at one n: quantile sketch plus histogram
+struct Distribution {
+    TDigest digest;
+    LogHistogram hist;
+
+    Distribution(int n = 2) : hist(n) {}
+
+    void add(double x) {
+        digest.add(x);
+        hist.add(x);
+    }  // add()
+
+    void merge(Distribution& other) {
+        digest.merge(other.digest);
+        hist.merge(other.hist);
+    }  // merge()
+}; // Distribution
+
+// Degrees of polymerization covered by the L_L/L_G sweep (40..3000 step 8 by default)
+std::vector<int> sweep_sizes(const Args& args) {
+    std::vector<int> sizes;
+    for(int n = args.n_min(); n <= args.n_max(); n += args.n_step()) {
+        sizes.push_back(n);
+    } // for
+    return sizes;
+} // sweep_sizes()
+
+// Write one value per line to path
+void write_column(const std::string& path, const std::vector<double>& values) {
+    std::ofstream file(path);
+    for(double value : values) {
+        file << value << "\n";
+    } // for
+} // write_column()
+
+// Write the four L_L/L_G result files for one generator configuration
+// Input: append (string) - suffix identifying the configuration (e.g. "_f_d")
+void write_results(const std::string& append,
+                   const std::vector<double>& L_L_means,
+                   const std::vector<double>& L_L_sems,
+                   const std::vector<double>& L_G_means,
+                   const std::vector<double>& L_G_sems) {
+    std::cout << L_L_means.size() << std::endl;
+    write_column("data/L_L_means" + append + ".txt", L_L_means);
+    write_column("data/L_L_sems" + append + ".txt", L_L_sems);
+    write_column("data/L_G_means" + append + ".txt", L_G_means);
+    write_column("data/L_G_sems" + append + ".txt", L_G_sems);
+} // write_results()
+
+// Write per-n covariances of the means of GG, GL, LG, LL, L_L and L_G
+// Rows are "n cov(GG,GG) cov(GG,GL) ... cov(L_G,L_G) corr(L_L,L_G)" over the upper triangle,
+// so a derived quantity f has variance grad f^T Cov grad f at each n.
+// Input: path (string) - output file
+//        sizes (vector<int>) - degree of polymerization of each row
+//        rows (vector<CoMoments>) - co-moments of each row
+void write_covariance(const std::string& path, 
+                      const std::vector<int>& sizes, 
+                      const std::vector<CoMoments<covariance_size>>& rows) {
+    std::ofstream file(path);
+    file << "n";
+    for(int i = 0; i < covariance_size; ++i) {
+        for(int j = i; j < covariance_size; ++j) {
+            file << " " << covariance_names[i] << "." << covariance_names[j];
+        } // for
+    } // for
+    file << " corr_L_L.L_G\n";
+
+    for(size_t row = 0; row < sizes.size(); ++row) {
+        file << sizes[row];
+        for(int i = 0; i < covariance_size; ++i) {
+            for(int j = i; j < covariance_size; ++j) {
+                file << " " << rows[row].mean_covariance(i, j);
+            } // for
+        } // for
+        file << " " << rows[row].correlation(4, 5) << "\n";
+    } // for
+} // write_covariance()
+
+// Write the per-n means and SEMs of each metric to data/<name>_{means,sems}<append>.txt
+// Input: metrics (vector<const Metric*>) - reported metrics
+//        append (string) - suffix identifying the configuration
+//        rows (vector<vector<Accumulator>>) - per n, one accumulator per metric
+void write_metrics(const std::vector<const Metric*>& metrics, 
+                   const std::string& append, 
+                   const std::vector<std::vector<Accumulator>>& rows) {
+    for(size_t m = 0; m < metrics.size(); ++m) {
+        std::vector<double> means, sems;
+        for(const std::vector<Accumulator>& row : rows) {
+            means.push_back(row[m].mean);
+            sems.push_back(row[m].sem());
+        } // for
+        write_column("data/" + std::string(metrics[m]->name) + "_means" + append + ".txt", means);
+        write_column("data/" + std::string(metrics[m]->name) + "_sems" + append + ".txt", sems);
+    } // for
+} // write_metrics()
+
+// Write per-n k-mer fractions as "n <kmer> <kmer>_sem ..." rows, with a header naming each k-mer
+// Input: path (string) - output file
+//        k (int) - k-mer length
+//        sizes (vector<int>) - degree of polymerization of each row
+//        means, sems (vector<vector<double>>) - per row, one value per k-mer code
+void write_kmers(const std::string& path, 
+                 int k, 
+                 const std::vector<int>& sizes, 
+                 const std::vector<std::vector<double>>& means, 
+                 const std::vector<std::vector<double>>& sems) {
+    std::ofstream file(path);
+    file << "n";
+    for(int c = 0; c < (1 << k); ++c) {
+        std::string name;
+        for(int j = 0; j < k; ++j) {
+            name += ((c >> j) & 1) ? 'G' : 'L';
+        } // for
+        file << " " << name << " " << name << "_sem";
+    } // for
+    file << "\n";
+
+    for(size_t row = 0; row < sizes.size(); ++row) {
+        file << sizes[row];
+        for(int c = 0; c < (1 << k); ++c) {
+            file << " " << means[row][c] << " " << sems[row][c];
+        } // for
+        file << "\n";
+    } // for
+} // write_kmers()
+
+// Write per-n run length probabilities as "n L1 L2 ... L<max>+ G1 ... G<max>+" rows
+// Each probability is the share of that type's runs with the given length.
+// Input: path (string) - output file
+//        sizes (vector<int>) - degree of polymerization of each row
+//        hists (vector<RunHistogram>) - run counts of each row
+void write_runs(const std::string& path, 
+                const std::vector<int>& sizes, 
+                const std::vector<RunHistogram>& hists) {
+    std::ofstream file(path);
+    int max_len = hists.empty() ? 0 : hists[0].L.size();
+    file << "n";
+    for(char type : {'L', 'G'}) {
+        for(int l = 1; l <= max_len; ++l) {
+            file << " " << type << l << (l == max_len ? "+" : "");
+        } // for
+    } // for
+    file << "\n";
+
+    for(size_t row = 0; row < sizes.size(); ++row) {
+        file << sizes[row];
+        for(const std::vector<long long>* bins : {&hists[row].L, &hists[row].G}) {
+            long long total = std::accumulate(bins->begin(), bins->end(), 0ll);
+            for(long long count : *bins) {
+                file << " " << (total > 0 ? (double)count / total : 0.0);
+            } // for
+        } // for
+        file << "\n";
+    } // for
+} // write_runs()
+
+// Write per-n bootstrap intervals as "n mean lo hi bca_lo bca_hi" rows
+// Input: path (string) - output file
+//        sizes (vector<int>) - degree of polymerization of each row
+//        means (vector<double>) - sample mean of each row
+//        cis (vector<BootstrapCI>) - intervals of each row
+void write_intervals(const std::string& path, 
+                     const std::vector<int>& sizes, 
+                     const std::vector<double>& means, 
+                     const std::vector<BootstrapCI>& cis) {
+    std::ofstream file(path);
+    file << "n mean lo hi bca_lo bca_hi\n";
+    for(size_t row = 0; row < sizes.size(); ++row) {
+        file << sizes[row] << " " << means[row] << " " << cis[row].lo << " " << cis[row].hi 
+             << " " << cis[row].bca_lo << " " << cis[row].bca_hi << "\n";
+    } // for
+} // write_intervals()
+
+// Probabilities reported by --quantiles
+const double report_quantiles[] = {0.01, 0.05, 0.25, 0.5, 0.75, 0.95, 0.99};
+
+// Write per-n quantiles ("n q0.01 ... q0.99") and log-binned histograms ("n f0 ... f63",
+// fractions of replicates in bin i = [n^(i/64), n^((i+1)/64))) of one L_L/L_G quantity
+// Input: name (string) - "L_L" or "L_G"
+//        append (string) - suffix identifying the configuration
+//        sizes (vector<int>) - degree of polymerization of each row
+//        dists (vector<Distribution>) - sketches of each row
+void write_distributions(const std::string& name, 
+                         const std::string& append, 
+                         const std::vector<int>& sizes, 
+                         std::vector<Distribution>& dists) {
+    std::ofstream quantiles("data/" + name + "_quantiles" + append + ".txt");
+    std::ofstream hist("data/" + name + "_hist" + append + ".txt");
+    quantiles << "n";
+    for(double q : report_quantiles) {
+        quantiles << " q" << q;
+    } // for
+    quantiles << "\n";
+
+    for(size_t row = 0; row < sizes.size(); ++row) {
+        quantiles << sizes[row];
+        for(double q : report_quantiles) {
+            quantiles << " " << dists[row].digest.quantile(q);
+        } // for
+        quantiles << "\n";
+
+        const std::vector<long long>& counts = dists[row].hist.counts();
+        long long total = std::accumulate(counts.begin(), counts.end(), 0ll);
+        hist << sizes[row];
+        for(long long count : counts) {
+            hist << " " << (double)count / total;
+        } // for
+        hist << "\n";
+    } // for
+} // write_distributions()
+
+// Suffix of the result files for the generator options in args
+std::string result_suffix(const Args& args) {
+    std::string append = "";
+    if(args.model() == Model::terminal) append += "_t";
+    if(args.model() == Model::penultimate) append += "_p";
+    if(args.fixed()) append += "_f";
+    if(args.dimers()) append += "_d";
+    if(args.direct()) append += "_direct";
+    if(!args.dimer_probs().empty()) append += "_hd";
+    if(args.cyclic()) append += "_c";
+    if(args.gradient()) append += "_grad";
+    if(args.stratified()) append += "_strat";
+    if(args.qmc()) append += "_qmc";
+    if(args.lengths() == LengthDist::flory) append += "_flory";
+    if(args.lengths() == LengthDist::schulz) append += "_schulz";
+    if(args.lengths() == LengthDist::poisson) append += "_poisson";
+    return append;
+} // result_suffix()
+
+// Every option that changes the generated chains, as text, so runs whose result files
+// share a suffix can still be told apart (e.g. shards made with different --g_prob)
+std::string generator_options(const Args& args) {
+    std::ostringstream out;
+    out.precision(17);
+    out << "g_prob " << args.g_prob() << " fixed " << args.fixed() << " dimers " << args.dimers() 
+        << " direct " << args.direct() << " model " << (int)args.model() << " r_L " << args.r_L() 
+        << " r_G " << args.r_G() << " r_GL " << args.r_GL() << " r_LG " << args.r_LG() 
+        << " lengths " << (int)args.lengths() << " schulz_k " << args.schulz_k() 
+        << " cyclic " << args.cyclic() << " conversion " << args.conversion() << " qmc " << args.qmc();
+    out << " dimer_probs";
+    for(double p : args.dimer_probs()) out << " " << p;
+    out << " monomers";
+    for(double p : args.monomers()) out << " " << p;
+    out << " gradient " << args.gradient();
+    if(args.gradient() && !args.gradient_file().empty()) {
+        // the profile itself, not its path
+        std::ifstream profile(args.gradient_file());
+        if(profile) out << "\n" << profile.rdbuf();
+    } // if
+    return out.str();
+} // generator_options()
+
+// Replicates per block of the sampled sweep, the unit of its substreams, threads and
+// shards (merge reads it back from the shard headers)
+const int sweep_block = 500;
+
+// Engine for one piece of the sampled sweep, seeded from (run seed, n, stream) so any
+// process can regenerate any piece on its own. Streams: block index for replicates,
+// -1 for replicate lengths, -2 for bootstrap, -3 - k for stratum k of --stratified.
+std::default_random_engine substream(uint64_t seed, int n, int stream) {
+    std::seed_seq seeds{(uint32_t)seed, (uint32_t)(seed >> 32), (uint32_t)n, (uint32_t)stream};
+    return std::default_random_engine(seeds);
+} // substream()
+
+// Mergeable results of one block of replicates, the unit shards write out
+struct BlockResult {
+    Accumulator L_L;
+    Accumulator L_G;
+    std::vector<Accumulator> metrics;
+    CoMoments<covariance_size> covariance;
+}; // BlockResult
+
+// Per-n results of the sampled sweep, reduced from block results in block order so a
+// single process and a merge of shards produce the same numbers
+struct SweepResults {
+    std::vector<double> L_L_means;
+    std::vector<double> L_L_sems;
+    std::vector<double> L_G_means;
+    std::vector<double> L_G_sems;
+    std::vector<std::vector<Accumulator>> metric_rows;
+    std::vector<CoMoments<covariance_size>> covariance_rows;
+
+    // Reduce the blocks of the next n
+    // With randomized = true the blocks are independent randomizations of one quasi-random
+    // point set, so the SEMs come from the spread of the block means instead.
+    void add(const std::vector<BlockResult>& blocks, int metrics, bool randomized = false) {
+        Accumulator L_L, L_G;
+        std::vector<Accumulator> row(metrics);
+        CoMoments<covariance_size> covariance;
+        for(const BlockResult& block : blocks) {
+            L_L.merge(block.L_L);
+            L_G.merge(block.L_G);
+            for(int m = 0; m < metrics; ++m) {
+                row[m].merge(block.metrics[m]);
+            } // for
+            covariance.merge(block.covariance);
+        } // for
+        L_L_means.push_back(L_L.mean);
+        L_L_sems.push_back(L_L.sem());
+        L_G_means.push_back(L_G.mean);
+        L_G_sems.push_back(L_G.sem());
+        if(randomized) {
+            Accumulator L_L_blocks, L_G_blocks;
+            for(const BlockResult& block : blocks) {
+                L_L_blocks.add(block.L_L.mean);
+                L_G_blocks.add(block.L_G.mean);
+            } // for
+            L_L_sems.back() = L_L_blocks.sem();
+            L_G_sems.back() = L_G_blocks.sem();
+        } // if
+        metric_rows.push_back(row);
+        covariance_rows.push_back(covariance);
+    }  // add()
+
+    void write(const std::string& append, 
+               const std::vector<int>& sizes, 
+               const std::vector<const Metric*>& metrics, 
+               bool covariance) const {
+        write_results(append, L_L_means, L_L_sems, L_G_means, L_G_sems);
+        write_metrics(metrics, append, metric_rows);
+        if(covariance) write_covariance("data/covariance" + append + ".txt", sizes, covariance_rows);
+    }  // write()
+}; // SweepResults
+
+// Partial result file of one shard: a header describing the run, then one record per
+// block the shard owns ("n index, block, BlockResult"), in native byte order
+const char shard_magic[8] = {'P', 'L', 'G', 'A', 'S', 'H', 'R', 'D'};
+const uint32_t shard_version = 2;
+
+struct ShardHeader {
+    uint64_t seed;
+    int32_t shard_index;
+    int32_t shard_count;
+    int32_t replicates;
+    int32_t block;
+    int32_t covariance;
+    std::string suffix;
+    std::string options;    // generator_options() of the run
+    std::vector<int> sizes;
+    std::vector<std::string> metrics;
+}; // ShardHeader
+
+template <typename T>
+void write_raw(std::ostream& out, const T& value) {
+    out.write((const char*)&value, sizeof(T));
+} // write_raw()
+
+template <typename T>
+bool read_raw(std::istream& in, T& value) {
+    return (bool)in.read((char*)&value, sizeof(T));
+} // read_raw()
+
+void write_raw(std::ostream& out, const std::string& value) {
+    write_raw(out, (uint32_t)value.size());
+    out.write(value.data(), value.size());
+} // write_raw()
+
+bool read_raw(std::istream& in, std::string& value) {
+    uint32_t size;
+    if(!read_raw(in, size) || size > (1u << 20)) return false;
+    value.resize(size);
+    return (bool)in.read(&value[0], size);
+} // read_raw()
+
+void write_shard_header(std::ostream& out, const ShardHeader& header) {
+    out.write(shard_magic, sizeof(shard_magic));
+    write_raw(out, shard_version);
+    write_raw(out, header.seed);
+    write_raw(out, header.shard_index);
+    write_raw(out, header.shard_count);
+    write_raw(out, header.replicates);
+    write_raw(out, header.block);
+    write_raw(out, header.covariance);
+    write_raw(out, header.suffix);
+    write_raw(out, header.options);
+    write_raw(out, (uint32_t)header.sizes.size());
+    for(int n : header.sizes) write_raw(out, (int32_t)n);
+    write_raw(out, (uint32_t)header.metrics.size());
+    for(const std::string& name : header.metrics) write_raw(out, name);
+} // write_shard_header()
+
+bool read_shard_header(std::istream& in, ShardHeader& header) {
+    char magic[sizeof(shard_magic)];
+    uint32_t version, count;
+    if(!in.read(magic, sizeof(magic)) || std::memcmp(magic, shard_magic, sizeof(magic)) != 0) return false;
+    if(!read_raw(in, version) || version != shard_version) return false;
+    if(!read_raw(in, header.seed) || !read_raw(in, header.shard_index) || !read_raw(in, header.shard_count) 
+       || !read_raw(in, header.replicates) || !read_raw(in, header.block) || !read_raw(in, header.covariance) 
+       || !read_raw(in, header.suffix) || !read_raw(in, header.options) 
+       || !read_raw(in, count) || count > (1u << 24)) return false;
+    if(header.shard_count < 1 || header.shard_index < 0 || header.shard_index >= header.shard_count 
+       || header.replicates < 1 || header.block < 1) return false;
+    header.sizes.resize(count);
+    for(int& n : header.sizes) {
+        int32_t value;
+        if(!read_raw(in, value)) return false;
+        n = value;
+    } // for
+    if(!read_raw(in, count) || count > (1u << 10)) return false;
+    header.metrics.resize(count);
+    for(std::string& name : header.metrics) {
+        if(!read_raw(in, name)) return false;
+    } // for
+    return true;
+} // read_shard_header()
+
+void write_block_result(std::ostream& out, int n_index, int block, const BlockResult& result, bool covariance) {
+    write_raw(out, (int32_t)n_index);
+    write_raw(out, (int32_t)block);
+    write_raw(out, result.L_L);
+    write_raw(out, result.L_G);
+    for(const Accumulator& metric : result.metrics) write_raw(out, metric);
+    if(covariance) write_raw(out, result.covariance);
+} // write_block_result()
+
+// Combine the partial files of every shard of a run into its final results
+// The blocks are reduced in the same order as in a single process, so the output matches
+// a single run with the same --seed and options.
+// Input: paths (vector<string>) - partial files, one per shard, in any order
+int run_merge(const std::vector<std::string>& paths) {
+    if(paths.empty()) {
+        std::cerr << "Error: merge needs the partial files of every shard\n";
+        return 1;
+    } // if
+
+    ShardHeader run;
+    std::vector<bool> seen_shard;
+    std::vector<std::vector<BlockResult>> blocks;
+    std::vector<std::vector<bool>> seen_block;
+    int num_blocks = 0;
+
+    for(size_t f = 0; f < paths.size(); ++f) {
+        std::ifstream in(paths[f], std::ios::binary);
+        ShardHeader header;
+        if(!in || !read_shard_header(in, header)) {
+            std::cerr << "Error: " << paths[f] << " is not a shard partial file\n";
+            return 1;
+        } // if
+        if(f == 0) {
+            run = header;
+            seen_shard.assign(run.shard_count, false);
+            num_blocks = (run.replicates + run.block - 1) / run.block;
+            BlockResult empty;
+            empty.metrics.resize(run.metrics.size());
+            blocks.assign(run.sizes.size(), std::vector<BlockResult>(num_blocks, empty));
+            seen_block.assign(run.sizes.size(), std::vector<bool>(num_blocks, false));
+        } else if(header.seed != run.seed || header.shard_count != run.shard_count 
+                  || header.replicates != run.replicates || header.block != run.block 
+                  || header.covariance != run.covariance || header.suffix != run.suffix 
+                  || header.sizes != run.sizes || header.metrics != run.metrics) {
+            std::cerr << "Error: " << paths[f] << " belongs to a different run\n";
+            return 1;
+        } else if(header.options != run.options) {
+            std::cerr << "Error: " << paths[f] << " was made with different generator options\n";
+            return 1;
+        } // if...else
+        if(seen_shard[header.shard_index]) {
+            std::cerr << "Error: shard " << header.shard_index << " given twice\n";
+            return 1;
+        } // if
+        seen_shard[header.shard_index] = true;
+
+        int32_t n_index, block;
+        while(read_raw(in, n_index) && read_raw(in, block)) {
+            if(n_index < 0 || n_index >= (int)run.sizes.size() || block < 0 || block >= num_blocks 
+               || seen_block[n_index][block]) {
+                std::cerr << "Error: bad block record in " << paths[f] << "\n";
+                return 1;
+            } // if
+            BlockResult& result = blocks[n_index][block];
+            bool ok = read_raw(in, result.L_L) && read_raw(in, result.L_G);
+            for(Accumulator& metric : result.metrics) ok = ok && read_raw(in, metric);
+            if(run.covariance) ok = ok && read_raw(in, result.covariance);
+            if(!ok) {
+                std::cerr << "Error: " << paths[f] << " is truncated\n";
+                return 1;
+            } // if
+            seen_block[n_index][block] = true;
+        } // while
+    } // for
+
+    for(int i = 0; i < run.shard_count; ++i) {
+        if(!seen_shard[i]) {
+            std::cerr << "Error: shard " << i << " of " << run.shard_count << " is missing\n";
+            return 1;
+        } // if
+    } // for
+    for(const std::vector<bool>& row : seen_block) {
+        if(std::find(row.begin(), row.end(), false) != row.end()) {
+            std::cerr << "Error: the partial files do not cover every block\n";
+            return 1;
+        } // if
+    } // for
+
+    std::vector<const Metric*> metrics = find_metrics(run.metrics);
+    SweepResults results;
+    for(const std::vector<BlockResult>& row : blocks) {
+        results.add(row, metrics.size());
+    } // for
+    results.write(run.suffix, run.sizes, metrics, run.covariance);
+    return 0;
+} // run_merge()
+
+// log(i!) for i = 0..max
+std::vector<double> log_factorials(int max) {
+    std::vector<double> log_fact(max + 1, 0.0);
+    for(int i = 1; i <= max; ++i) {
+        log_fact[i] = log_fact[i - 1] + log((double)i);
+    } // for
+    return log_fact;
+} // log_factorials()
+
+// Visit every class of linear chains with a L's and b G's that share the same dyad counts
+// A chain with its L's in r runs and G's in s runs (|r - s| <= 1) has LL = a - r and
+// GG = b - s, with LG/GL fixed by which monomers start and end it, and there are
+// C(a-1, r-1) * C(b-1, s-1) ways of cutting the monomers into those runs.
+// The class also fixes the dyad that would close the chain into a ring (last monomer to
+// first), which is passed as wrap (0 = LL, 1 = LG, 2 = GL, 3 = GG) for cyclic chains.
+// Input: a, b (int) - number of L and G monomers
+//        log_fact (vector<double>) - log(i!) for i = 0..a+b
+//        visit (F) - called as visit(log_count, LL, LG, GL, GG, wrap) once per class
+template <typename F>
+void for_each_run_class(int a, int b, const std::vector<double>& log_fact, F visit) {
+    auto log_choose = [&](int x, int y) {
+        return log_fact[x] - log_fact[y] - log_fact[x - y];
+    };
+
+    if(a == 0 || b == 0) {
+        visit(0.0, std::max(a - 1, 0), 0, 0, std::max(b - 1, 0), (b == 0) ? 0 : 3);
+        return;
+    } // if
+
+    for(int r = 1; r <= a && r <= b + 1; ++r) {
+        double log_r = log_choose(a - 1, r - 1);
+        // starts and ends with L: s = r - 1
+        if(r >= 2) {
+            visit(log_r + log_choose(b - 1, r - 2), a - r, r - 1, r - 1, b - r + 1, 0);
+        } // if
+        // starts with L and ends with G, or the reverse: s = r
+        if(r <= b) {
+            double log_s = log_r + log_choose(b - 1, r - 1);
+            visit(log_s, a - r, r, r - 1, b - r, 2);
+            visit(log_s, a - r, r - 1, r, b - r, 1);
+        } // if
+        // starts and ends with G: s = r + 1
+        if(r + 1 <= b) {
+            visit(log_r + log_choose(b - 1, r), a - r, r, r, b - r - 1, 3);
+        } // if
+    } // for
+} // for_each_run_class()
+
+// Add the ring-closing dyad of type wrap (0 = LL, 1 = LG, 2 = GL, 3 = GG) to the counts
+void add_wrap(int wrap, int& LL, int& LG, int& GL, int& GG) {
+    switch(wrap) {
+        case 0: LL++; break;
+        case 1: LG++; break;
+        case 2: GL++; break;
+        default: GG++; break;
+    } // switch
+} // add_wrap()
+
+// Exact first and second moments of L_L and L_G at one degree of polymerization
+struct Moments {
+    double L_L;
+    double L_L2;
+    double L_G;
+    double L_G2;
+}; // Moments
+
+// Calculate E[L_L], E[L_L^2], E[L_G] and E[L_G^2] exactly (no Monte Carlo error)
+// Every sequence in a run class (see for_each_run_class()) has the same dyad counts
+// and the same probability, so the transfer matrix of the two-state chain collapses
+// to a sum over compositions and run classes: O(n^2) work and O(n) memory per n.
+// Input: n, g_prob, fixed, dimers - same as gen()
+//        cyclic (bool) - count the ring-closing dyad
+//        log_fact (vector<double>) - log(i!) for i = 0..n
+Moments exact_moments(int n, 
+                      double g_prob, 
+                      bool fixed, 
+                      bool dimers, 
+                      bool cyclic, 
+                      const std::vector<double>& log_fact) {
+    Moments moments = {0, 0, 0, 0};
+    int m = dimers ? n / 2 : n;
+    if(m < 1) return moments;
+
+    auto log_choose = [&](int x, int y) {
+        return log_fact[x] - log_fact[y] - log_fact[x - y];
+    };
+
+    int b_lo = 0;
+    int b_hi = m;
+    if(fixed) b_lo = b_hi = fixed_g_count(m, g_prob);
+
+    for(int b = b_lo; b <= b_hi; ++b) {
+        int a = m - b;
+
+        // log probability of one particular sequence with b G's
+        double log_seq;
+        if(fixed) {
+            log_seq = -log_choose(m, b);
+        } else {
+            if((a > 0 && g_prob >= 1) || (b > 0 && g_prob <= 0)) continue;
+            log_seq = (a > 0 ? a * log1p(-g_prob) : 0) + (b > 0 ? b * log(g_prob) : 0);
+            // compositions this far in the binomial tail contribute nothing in double precision
+            if(log_choose(m, b) + log_seq < -60) continue;
+        } // if...else
+
+        // Doubling every monomer (dimers) adds one LL per L and one GG per G
+        for_each_run_class(a, b, log_fact, [&](double log_count, int LL, int LG, int GL, int GG, int wrap) {
+            if(dimers) {
+                LL += a;
+                GG += b;
+            } // if
+            if(cyclic && m >= 2) add_wrap(wrap, LL, LG, GL, GG);
+            double w = exp(log_seq + log_count);
+            double L_L = (double)LL / (double)std::max(LG, 1) + 1;
+            double L_G = (double)GG / (double)std::max(GL, 1) + 1;
+            moments.L_L += w * L_L;
+            moments.L_L2 += w * L_L * L_L;
+            moments.L_G += w * L_G;
+            moments.L_G2 += w * L_G * L_G;
+        });
+    } // for
+
+    return moments;
+} // exact_moments()
+
+// Probability of every number of G units among m units of a terminal-model chain
+// A forward pass over the units carries the probability of each (G count, last unit)
+// state. Only the band of counts above 1e-40 is kept, which drops less than 1e-36 of
+// probability in all, so a pass costs O(m) per unit in the width of the band.
+// Input: m (int) - number of units
+//        model (RunModel) - transition probabilities of a terminal model
+std::vector<double> markov_g_counts(int m, const RunModel& model) {
+    const double negligible = 1e-40;
+    std::vector<double> L(m + 2, 0.0), G(m + 2, 0.0);   // by G count, last unit L or G
+    L[0] = 1 - model.p_start_G;
+    G[1] = model.p_start_G;
+    int lo = 0, hi = 1;
+    for(int i = 1; i < m; ++i) {
+        // downward, so G[b + 1] is overwritten only after its old value was used
+        for(int b = hi; b >= lo; --b) {
+            double last_L = L[b];
+            double last_G = G[b];
+            L[b] = last_L * model.p_L_stay + last_G * (1 - model.p_G_stay);
+            G[b + 1] = last_L * (1 - model.p_L_stay) + last_G * model.p_G_stay;
+        } // for
+        G[lo] = 0;
+        ++hi;
+        while(hi > lo && L[hi] + G[hi] < negligible) {
+            L[hi] = G[hi] = 0;
+            --hi;
+        } // while
+        while(lo < hi && L[lo] + G[lo] < negligible) {
+            L[lo] = G[lo] = 0;
+            ++lo;
+        } // while
+    } // for
+
+    std::vector<double> counts(m + 1);
+    for(int b = 0; b <= m; ++b) {
+        counts[b] = L[b] + G[b];
+    } // for
+    return counts;
+} // markov_g_counts()
+
+// Calculate E[L_L], E[L_L^2], E[L_G] and E[L_G^2] exactly for the terminal model
+// A first-order Markov chain gives a sequence the probability
+// P(first unit) * p_LL^LL * p_LG^LG * p_GL^GL * p_GG^GG, which is again the same for every
+// sequence of a run class (the class fixes the first unit through its wrap dyad).
+// As in exact_moments(), compositions below e^-60 in all are skipped, here by their
+// probability from markov_g_counts().
+// Input: n, dimers, cyclic, log_fact - same as exact_moments()
+//        model (RunModel) - transition probabilities of a terminal model (p_first == p_stay)
+Moments exact_markov_moments(int n, 
+                             const RunModel& model, 
+                             bool dimers, 
+                             bool cyclic, 
+                             const std::vector<double>& log_fact) {
+    Moments moments = {0, 0, 0, 0};
+    int m = dimers ? n / 2 : n;
+    if(m < 1) return moments;
+
+    // count * log(p), with p^0 = 1 even for p = 0
+    auto log_power = [](int count, double p) {
+        return count ? count * log(p) : 0.0;
+    };
+
+    std::vector<double> compositions = markov_g_counts(m, model);
+    for(int b = 0; b <= m; ++b) {
+        int a = m - b;
+        // compositions this unlikely contribute nothing in double precision
+        if(compositions[b] < exp(-60)) continue;
+        for_each_run_class(a, b, log_fact, [&](double log_count, int LL, int LG, int GL, int GG, int wrap) {
+            bool starts_G = (wrap == 1 || wrap == 3);
+            double log_seq = log(starts_G ? model.p_start_G : 1 - model.p_start_G) 
+                             + log_power(LL, model.p_L_stay) + log_power(LG, 1 - model.p_L_stay) 
+                             + log_power(GL, 1 - model.p_G_stay) + log_power(GG, model.p_G_stay);
+            // impossible classes (log 0) and classes below double precision
+            if(!(log_seq + log_count > -745)) return;
+            if(dimers) {
+                LL += a;
+                GG += b;
+            } // if
+            if(cyclic && m >= 2) add_wrap(wrap, LL, LG, GL, GG);
+            double w = exp(log_seq + log_count);
+            double L_L = (double)LL / (double)std::max(LG, 1) + 1;
+            double L_G = (double)GG / (double)std::max(GL, 1) + 1;
+            moments.L_L += w * L_L;
+            moments.L_L2 += w * L_L * L_L;
+            moments.L_G += w * L_G;
+            moments.L_G2 += w * L_G * L_G;
+        });
+    } // for
+
+    return moments;
+} // exact_markov_moments()
+
+// Exact moments at sweep point n for the options in args (bernoulli or terminal model)
+Moments exact_point(const Args& args, int n, const std::vector<double>& log_fact) {
+    if(args.model() == Model::terminal) {
+        return exact_markov_moments(n, run_model(args, args.g_prob()), args.dimers(), args.cyclic(), log_fact);
+    } // if
+    return exact_moments(n, args.g_prob(), args.fixed(), args.dimers(), args.cyclic(), log_fact);
+} // exact_point()
+
+// Draws the dyad counts of fixed-composition chains without building any sequence
+// Every arrangement of the k G's is equally likely, so the run classes of
+// for_each_run_class() are drawn with probability count / C(m, k) from an alias table:
+// O(k) to build per n, O(1) per replicate.
+class DyadSampler {
+private:
+    std::vector<Stats> _outcomes;
+    AliasTable _table;
+
+public:
+    DyadSampler() {}
+
+    // Input: n, g_prob, dimers - same as gen() with fixed = true
+    //        cyclic (bool) - count the ring-closing dyad
+    //        log_fact (vector<double>) - log(i!) for i = 0..n
+    DyadSampler(int n, double g_prob, bool dimers, bool cyclic, const std::vector<double>& log_fact) 
+        : DyadSampler(with_g_units(n, fixed_g_count(dimers ? n / 2 : n, g_prob), dimers, cyclic, log_fact)) {}
+
+    // Sampler for chains of n monomers holding exactly b G units (monomers or dimers)
+    static DyadSampler with_g_units(int n, int b, bool dimers, bool cyclic, const std::vector<double>& log_fact) {
+        DyadSampler sampler;
+        int width = dimers ? 2 : 1;
+        int m = n / width;
+        int a = m - b;
+        double log_total = log_fact[m] - log_fact[a] - log_fact[b];
+
+        std::vector<double> weights;
+        for_each_run_class(a, b, log_fact, [&](double log_count, int LL, int LG, int GL, int GG, int wrap) {
+            // classes this rare never come up in any feasible number of replicates
+            if(log_count - log_total < -45) return;
+            if(dimers) {
+                LL += a;
+                GG += b;
+            } // if
+            if(cyclic && m >= 2) add_wrap(wrap, LL, LG, GL, GG);
+            sampler._outcomes.push_back({GG, LL, GL, LG, b * width, a * width});
+            weights.push_back(exp(log_count - log_total));
+        });
+        sampler._table = AliasTable(weights);
+        return sampler;
+    }  // with_g_units()
+
+    template <typename Engine>
+    Stats operator()(Engine& engine) const {
+        return _outcomes[_table(engine)];
+    }  // operator()
+}; // DyadSampler
+
+// Chain lengths of the replicates at one mean degree of polymerization
+// The length distribution is tabulated once per mean n (tails below 1e-12 are cut and
+// lengths start at 2, the shortest chain with a dyad) and drawn in O(1) from an alias table.
+class ReplicateLengths {
+private:
+    int _min_len;
+    AliasTable _table;
+
+public:
+    // Input: dist (LengthDist) - distribution family (not monodisperse)
+    //        n (int) - mean degree of polymerization
+    //        schulz_k (double) - shape of the Schulz-Zimm distribution
+    ReplicateLengths(LengthDist dist, int n, double schulz_k) : _min_len(2) {
+        // log of the unnormalized probability of a chain of len units
+        auto log_p = [&](int len) {
+            switch(dist) {
+                case LengthDist::flory:
+                    return (len - 1) * log1p(-1.0 / n);
+                case LengthDist::schulz:
+                    return (schulz_k - 1) * log((double)len) - schulz_k * len / n;
+                case LengthDist::poisson:
+                default:
+                    return (len - 1) * log(n - 1.0) - lgamma((double)len);
+            } // switch
+        };
+
+        int mode = _min_len;
+        if(dist == LengthDist::schulz) mode = std::max(_min_len, (int)((schulz_k - 1) * n / schulz_k));
+        if(dist == LengthDist::poisson) mode = std::max(_min_len, n - 1);
+        double log_peak = log_p(mode);
+
+        std::vector<double> weights;
+        int len = _min_len;
+        for(; len < mode || log_p(len) - log_peak > log(1e-12); ++len) {
+            weights.push_back(exp(log_p(len) - log_peak));
+        } // for
+        _table = AliasTable(weights);
+    }  // ReplicateLengths()
+
+    template <typename Engine>
+    int operator()(Engine& engine) const {
+        return _min_len + _table(engine);
+    }  // operator()
+}; // ReplicateLengths
+
+// Lengths of the N replicates at sweep point n, sorted so chains of similar length are
+// generated together and the packed buffers stay the same size from one to the next
+std::vector<int> replicate_lengths(const Args& args, 
+                                   int n, 
+                                   int N, 
+                                   std::default_random_engine& engine) {
+    std::vector<int> lengths(N, n);
+    if(args.lengths() == LengthDist::monodisperse) return lengths;
+
+    ReplicateLengths dist(args.lengths(), n, args.schulz_k());
+    for(int i = 0; i < N; ++i) {
+        lengths[i] = dist(engine);
+    } // for
+    std::sort(lengths.begin(), lengths.end());
+    return lengths;
+} // replicate_lengths()
+
+// On-disk store of per-replicate dyad counts, one entry per n
+// Layout (native byte order, every part 8-byte aligned so the file can be used in place
+// through mmap): StoreHeader, StoreEntry[entries], then per entry its columns
+// LL, LG, GL, GG and the G and L monomer counts. A column is frame-of-reference coded:
+// each count minus the column minimum, bit-packed at the width of the largest difference
+// (0 bits if all equal).
+// Counts are in replicate order, which is random, so there is no ordering for delta
+// coding to exploit; the spread of a column is what sets its size.
+const char store_magic[8] = {'P', 'L', 'G', 'A', 'D', 'Y', 'A', 'D'};
+const uint32_t store_version = 2;
+const int store_columns = 6;
+
+struct StoreHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t entries;
+    char suffix[48];    // result_suffix() of the run that wrote it
+}; // StoreHeader
+
+struct StoreEntry {
+    int32_t n;
+    int32_t replicates;
+    int32_t base[store_columns];        // column minimum
+    uint32_t width[store_columns];      // bits per packed value
+    uint64_t offset[store_columns];     // byte offset of the column from the start of the file
+}; // StoreEntry
+
+// Number of 64-bit words in a packed column
+inline uint64_t store_column_words(int replicates, int width) {
+    return ((uint64_t)replicates * width + 63) / 64;
+} // store_column_words()
+
+// Read value r of a packed column (width < 64)
+inline uint32_t store_unpack(const uint64_t * column, int width, int r) {
+    uint64_t bit = (uint64_t)r * width;
+    uint64_t word = bit >> 6;
+    int shift = bit & 63;
+    uint64_t value = column[word] >> shift;
+    if(shift + width > 64) value |= column[word + 1] << (64 - shift);
+    return (uint32_t)(value & ((1ull << width) - 1));
+} // store_unpack()
+
+// Writes a dyad count store entry by entry as the sweep runs
+class StoreWriter {
+private:
+    std::ofstream _file;
+    std::vector<StoreEntry> _entries;
+    uint64_t _offset;
+
+public:
+    // Input: path (string) - output file
+    //        suffix (string) - result suffix of the run
+    //        entries (int) - number of entries that will be added
+    StoreWriter(const std::string& path, const std::string& suffix, int entries) 
+        : _file(path, std::ios::binary) {
+        if(!_file) {
+            std::cerr << "Error: cannot write " << path << "\n";
+            exit(1);
+        } // if
+        StoreHeader header = {};
+        std::memcpy(header.magic, store_magic, sizeof(store_magic));
+        header.version = store_version;
+        header.entries = entries;
+        std::strncpy(header.suffix, suffix.c_str(), sizeof(header.suffix) - 1);
+        _file.write((const char*)&header, sizeof(header));
+        // the entry table is filled in as entries arrive
+        _entries.reserve(entries);
+        std::vector<char> table(entries * sizeof(StoreEntry), 0);
+        _file.write(table.data(), table.size());
+        _offset = sizeof(header) + table.size();
+    }  // StoreWriter()
+
+    // Append the counts of every replicate at one n
+    void add(int n, const std::vector<Stats>& stats) {
+        StoreEntry entry = {};
+        entry.n = n;
+        entry.replicates = stats.size();
+        for(int c = 0; c < store_columns; ++c) {
+            auto count = [&](const Stats& s) {
+                const int values[store_columns] = {s.LLs, s.LGs, s.GLs, s.GGs, s.Gs, s.Ls};
+                return values[c];
+            };
+            int lo = INT32_MAX, hi = 0;
+            for(const Stats& s : stats) {
+                lo = std::min(lo, count(s));
+                hi = std::max(hi, count(s));
+            } // for
+            int width = 0;
+            while(width < 32 && ((uint64_t)(hi - lo) >> width)) ++width;
+
+            std::vector<uint64_t> column(store_column_words(stats.size(), width), 0);
+            for(size_t r = 0; r < stats.size() && width > 0; ++r) {
+                uint64_t value = count(stats[r]) - lo;
+                uint64_t bit = (uint64_t)r * width;
+                column[bit >> 6] |= value << (bit & 63);
+                if((bit & 63) + width > 64) column[(bit >> 6) + 1] |= value >> (64 - (bit & 63));
+            } // for
+
+            entry.base[c] = stats.empty() ? 0 : lo;
+            entry.width[c] = width;
+            entry.offset[c] = _offset;
+            _file.write((const char*)column.data(), column.size() * sizeof(uint64_t));
+            _offset += column.size() * sizeof(uint64_t);
+        } // for
+        _entries.push_back(entry);
+    }  // add()
+
+    ~StoreWriter() {
+        _file.seekp(sizeof(StoreHeader));
+        _file.write((const char*)_entries.data(), _entries.size() * sizeof(StoreEntry));
+    }  // ~StoreWriter()
+}; // StoreWriter
+
+// Read-only view of a dyad count store, mapped into memory
+// Derived metrics are computed lazily by scanning an entry: any function of Stats costs
+// one pass over the packed columns instead of a rerun of the sweep.
+class DyadStore {
+private:
+    const char * _data;
+    size_t _size;
+    const StoreHeader * _header;
+    const StoreEntry * _entries;
+
+public:
+    explicit DyadStore(const std::string& path) {
+        int fd = open(path.c_str(), O_RDONLY);
+        struct stat info;
+        if(fd < 0 || fstat(fd, &info) != 0) {
+            std::cerr << "Error: cannot read " << path << "\n";
+            exit(1);
+        } // if
+        _size = info.st_size;
+        void* map = (_size >= sizeof(StoreHeader)) ? mmap(nullptr, _size, PROT_READ, MAP_PRIVATE, fd, 0) : MAP_FAILED;
+        close(fd);
+        if(map == MAP_FAILED) {
+            std::cerr << "Error: cannot map " << path << "\n";
+            exit(1);
+        } // if
+        _data = (const char*)map;
+        _header = (const StoreHeader*)_data;
+        _entries = (const StoreEntry*)(_data + sizeof(StoreHeader));
+        if(std::memcmp(_header->magic, store_magic, sizeof(store_magic)) != 0 
+           || _header->version != store_version 
+           || sizeof(StoreHeader) + (uint64_t)_header->entries * sizeof(StoreEntry) > _size) {
+            std::cerr << "Error: " << path << " is not a dyad count store\n";
+            exit(1);
+        } // if
+        for(int e = 0; e < entries(); ++e) {
+            for(int c = 0; c < store_columns; ++c) {
+                if(_entries[e].width[c] > 32 || _entries[e].offset[c] % 8 
+                   || _entries[e].offset[c] + 8 * store_column_words(_entries[e].replicates, _entries[e].width[c]) > _size) {
+                    std::cerr << "Error: " << path << " is truncated\n";
+                    exit(1);
+                } // if
+            } // for
+        } // for
+    }  // DyadStore()
+
+    DyadStore(const DyadStore&) = delete;
+    DyadStore& operator=(const DyadStore&) = delete;
+
+    ~DyadStore() {
+        munmap((void*)_data, _size);
+    }  // ~DyadStore()
+
+    int entries() const {
+        return _header->entries;
+    }  // entries()
+
+    const StoreEntry& entry(int e) const {
+        return _entries[e];
+    }  // entry()
+
+    // Result suffix of the run that wrote the store
+    std::string suffix() const {
+        return std::string(_header->suffix, strnlen(_header->suffix, sizeof(_header->suffix)));
+    }  // suffix()
+
+    // Dyad counts of replicate r at entry e
+    Stats at(int e, int r) const {
+        const StoreEntry& entry = _entries[e];
+        int counts[store_columns];
+        for(int c = 0; c < store_columns; ++c) {
+            const uint64_t* column = (const uint64_t*)(_data + entry.offset[c]);
+            counts[c] = entry.base[c] + (entry.width[c] ? store_unpack(column, entry.width[c], r) : 0);
+        } // for
+        return {counts[3], counts[0], counts[2], counts[1], counts[4], counts[5]};
+    }  // at()
+
+    // Call visit(Stats) for every replicate of entry e, in order
+    template <typename F>
+    void scan(int e, F visit) const {
+        for(int r = 0; r < _entries[e].replicates; ++r) {
+            visit(at(e, r));
+        } // for
+    }  // scan()
+}; // DyadStore
+
+// Recompute the L_L/L_G sweep from a dyad count store and write it under the store's suffix,
+// along with any --metrics, all in one scan of each entry
+// Input: args (Args) - options, --load names the store
+void run_load(const Args& args) {
+    DyadStore store(args.load());
+    std::vector<const Metric*> metrics = find_metrics(args.metrics());
+    std::vector<double> L_L_means, L_L_sems, L_G_means, L_G_sems;
+    std::vector<std::vector<Accumulator>> metric_rows;
+    std::vector<CoMoments<covariance_size>> covariance_rows(store.entries());
+    std::vector<int> sizes;
+    for(int e = 0; e < store.entries(); ++e) {
+        std::vector<double> L_Ls, L_Gs;
+        std::vector<Accumulator> row(metrics.size());
+        sizes.push_back(store.entry(e).n);
+        store.scan(e, [&](const Stats& stats) {
+            // same clamp as calc_L_L_or_L_G()
+            L_Ls.push_back((double)stats.LLs / std::max(stats.LGs, 1) + 1);
+            L_Gs.push_back((double)stats.GGs / std::max(stats.GLs, 1) + 1);
+            for(size_t m = 0; m < metrics.size(); ++m) {
+                row[m].add(metrics[m]->value(stats));
+            } // for
+            if(args.covariance()) covariance_rows[e].add(covariance_values(stats));
+        });
+        metric_rows.push_back(row);
+        double L_L_mean = mean(L_Ls);
+        L_L_means.push_back(L_L_mean);
+        L_L_sems.push_back(sem(L_Ls, L_L_mean));
+        double L_G_mean = mean(L_Gs);
+        L_G_means.push_back(L_G_mean);
+        L_G_sems.push_back(sem(L_Gs, L_G_mean));
+    } // for
+    write_results(store.suffix(), L_L_means, L_L_sems, L_G_means, L_G_sems);
+    write_metrics(metrics, store.suffix(), metric_rows);
+    if(args.covariance()) {
+        write_covariance("data/covariance" + store.suffix() + ".txt", sizes, covariance_rows);
+    } // if
+} // run_load()
+
+// Compute the L_L/L_G sweep exactly and write it with the "_x" suffix
+// SEMs are the standard errors a sampled run of N replicates would have
+// Input: args (Args) - generator options
+//        N (int) - replicates per n of the equivalent sampled run
+void run_exact(const Args& args, int N) {
+    std::vector<int> sizes = sweep_sizes(args);
+    int count = sizes.size();
+
+    std::vector<double> log_fact = log_factorials(sizes.back());
+
+    std::vector<double> L_L_means(count), L_L_sems(count), L_G_means(count), L_G_sems(count);
+
+    // largest chains first so the expensive items do not trail at the end
+    parallel_for(count, args.threads(), [&](int item) {
+        int i = count - 1 - item;
+        Moments m = exact_point(args, sizes[i], log_fact);
+        L_L_means[i] = m.L_L;
+        L_L_sems[i] = sqrt(std::max(m.L_L2 - m.L_L * m.L_L, 0.0) / N);
+        L_G_means[i] = m.L_G;
+        L_G_sems[i] = sqrt(std::max(m.L_G2 - m.L_G * m.L_G, 0.0) / N);
+    });
+
+    write_results(result_suffix(args) + "_x", L_L_means, L_L_sems, L_G_means, L_G_sems);
+} // run_exact()
+
+// One measured point to fit: L_L and L_G with their standard errors at chain length n
+struct Measurement {
+    int n;
+    double L_L;
+    double L_L_err;
+    double L_G;
+    double L_G_err;
+}; // Measurement
+
+// Read "n L_L L_L_err L_G L_G_err" rows ('#' starts a comment)
+std::vector<Measurement> read_measurements(const std::string& path) {
+    std::ifstream file(path);
+    if(!file) {
+        std::cerr << "Error: cannot read " << path << "\n";
+        exit(1);
+    } // if
+    std::vector<Measurement> rows;
+    std::string line;
+    while(std::getline(file, line)) {
+        line = line.substr(0, line.find('#'));
+        if(line.find_first_not_of(" \t\r") == std::string::npos) continue;
+        std::istringstream in(line);
+        Measurement row;
+        if(!(in >> row.n >> row.L_L >> row.L_L_err >> row.L_G >> row.L_G_err) 
+           || row.n < 2 || !(row.L_L_err > 0) || !(row.L_G_err > 0)) {
+            std::cerr << "Error: " << path << " needs rows \"n L_L L_L_err L_G L_G_err\" with n >= 2 and errors > 0\n";
+            exit(1);
+        } // if
+        rows.push_back(row);
+    } // while
+    if(rows.empty()) {
+        std::cerr << "Error: " << path << " has no measurements\n";
+        exit(1);
+    } // if
+    return rows;
+} // read_measurements()
+
+// A fitted parameter and the range it is searched over (in log10 for ratios)
+struct FitParameter {
+    const char * name;
+    double lo;
+    double hi;
+    bool log_scale;
+}; // FitParameter
+
+// Fit the model parameters to the measured L_L/L_G of args.fit() by least squares
+// Bernoulli chains fit g_prob; terminal chains fit r_L and r_G at the feed --g_prob.
+// Every evaluation is exact (exact_point()), so the objective is smooth and noise free.
+// The search evaluates a grid over the whole range, then grids shrinking around the best
+// point, each grid spread over the threads; the uncertainty is the inverse of half the
+// chi^2 Hessian at the minimum. Results go to stdout and data/fit<suffix>.txt.
+void run_fit(const Args& args) {
+    std::vector<Measurement> data = read_measurements(args.fit());
+    int n_max = 2;
+    for(const Measurement& row : data) {
+        n_max = std::max(n_max, row.n);
+    } // for
+    std::vector<double> log_fact = log_factorials(n_max);
+
+    std::vector<FitParameter> params;
+    if(args.model() == Model::terminal) {
+        params = {{"r_L", -3, 3, true}, {"r_G", -3, 3, true}};
+    } else {
+        params = {{"g_prob", 0, 1, false}};
+    } // if...else
+    const int dims = params.size();
+
+    auto value = [&](int d, double x) {
+        return params[d].log_scale ? pow(10.0, x) : x;
+    };
+    auto chi2 = [&](const std::vector<double>& x) {
+        Args point = (dims == 2) ? args.with_ratios(value(0, x[0]), value(1, x[1])) 
+                                 : args.at_point(value(0, x[0]), false, args.dimers());
+        double sum = 0;
+        for(const Measurement& row : data) {
+            Moments m = exact_point(point, row.n, log_fact);
+            sum += pow((m.L_L - row.L_L) / row.L_L_err, 2) + pow((m.L_G - row.L_G) / row.L_G_err, 2);
+        } // for
+        return sum;
+    };
+    // evaluate every point of a list in parallel
+    auto evaluate = [&](const std::vector<std::vector<double>>& points) {
+        std::vector<double> values(points.size());
+        parallel_for(points.size(), args.threads(), [&](int i) {
+            values[i] = chi2(points[i]);
+        });
+        return values;
+    };
+
+    // grid search, shrinking to 2 grid steps around the best point each round
+    const int nodes = (dims == 1) ? 33 : 17;
+    std::vector<double> center(dims), half(dims);
+    for(int d = 0; d < dims; ++d) {
+        center[d] = (params[d].lo + params[d].hi) / 2;
+        half[d] = (params[d].hi - params[d].lo) / 2;
+    } // for
+    std::vector<double> best = center;
+    double best_chi2 = INFINITY;
+    for(int round = 0; round < 60 && half[0] > 1e-9 * (params[0].hi - params[0].lo); ++round) {
+        std::vector<std::vector<double>> points;
+        for(int k = 0; k < (dims == 1 ? nodes : nodes * nodes); ++k) {
+            std::vector<double> x(dims);
+            for(int d = 0, rest = k; d < dims; ++d, rest /= nodes) {
+                double lo = std::max(params[d].lo, center[d] - half[d]);
+                double hi = std::min(params[d].hi, center[d] + half[d]);
+                x[d] = lo + (hi - lo) * (rest % nodes) / (nodes - 1);
+            } // for
+            points.push_back(x);
+        } // for
+        std::vector<double> values = evaluate(points);
+        for(size_t k = 0; k < points.size(); ++k) {
+            if(values[k] < best_chi2) {
+                best_chi2 = values[k];
+                best = points[k];
+            } // if
+        } // for
+        center = best;
+        for(int d = 0; d < dims; ++d) {
+            half[d] *= 4.0 / (nodes - 1);
+        } // for
+    } // for
+
+    // Hessian of chi^2 by central differences (one-sided at the edge of the range)
+    std::vector<double> step(dims);
+    for(int d = 0; d < dims; ++d) {
+        step[d] = 1e-4 * (params[d].hi - params[d].lo);
+        best[d] = std::min(std::max(best[d], params[d].lo + step[d]), params[d].hi - step[d]);
+    } // for
+    std::vector<std::vector<double>> points;
+    for(int k = 0; k < (dims == 1 ? 3 : 9); ++k) {
+        std::vector<double> x = best;
+        for(int d = 0, rest = k; d < dims; ++d, rest /= 3) {
+            x[d] += (rest % 3 - 1) * step[d];
+        } // for
+        points.push_back(x);
+    } // for
+    std::vector<double> f = evaluate(points);
+    // f at offsets (i, j) in steps, i along the first parameter (j = 0 for one parameter)
+    auto at = [&](int i, int j) {
+        return f[(i + 1) + (dims == 2 ? 3 * (j + 1) : 0)];
+    };
+    std::vector<double> sigma(dims, NAN);
+    double correlation = NAN;
+    if(dims == 1) {
+        double h = (at(1, 0) - 2 * at(0, 0) + at(-1, 0)) / (step[0] * step[0]);
+        if(h > 0) sigma[0] = sqrt(2 / h);
+    } else {
+        double h00 = (at(1, 0) - 2 * at(0, 0) + at(-1, 0)) / (step[0] * step[0]);
+        double h11 = (at(0, 1) - 2 * at(0, 0) + at(0, -1)) / (step[1] * step[1]);
+        double h01 = (at(1, 1) - at(1, -1) - at(-1, 1) + at(-1, -1)) / (4 * step[0] * step[1]);
+        double det = h00 * h11 - h01 * h01;
+        if(h00 > 0 && det > 0) {
+            // covariance = 2 H^-1
+            sigma[0] = sqrt(2 * h11 / det);
+            sigma[1] = sqrt(2 * h00 / det);
+            correlation = -h01 / sqrt(h00 * h11);
+        } // if
+    } // if...else
+
+    std::ofstream file("data/fit" + result_suffix(args) + ".txt");
+    std::ostringstream out;
+    out << "# parameter value sigma\n";
+    for(int d = 0; d < dims; ++d) {
+        double x = value(d, best[d]);
+        // a log10-scale sigma s is a relative error of ln(10) s
+        double s = params[d].log_scale ? x * log(10.0) * sigma[d] : sigma[d];
+        out << params[d].name << " " << x << " " << s << "\n";
+    } // for
+    if(dims == 2) out << "correlation " << correlation << "\n";
+    out << "chi2 " << at(0, 0) << "\n";
+    out << "dof " << 2 * (int)data.size() - dims << "\n";
+    file << out.str();
+    std::cout << out.str();
+} // run_fit()
+
+// One stratum of G counts [lo, hi] for --stratified, with its samplers and draws so far
+struct Stratum {
+    int lo;
+    int hi;
+    double weight;                      // binomial probability of the stratum
+    AliasTable counts;                  // G count within the stratum, offset from lo
+    std::vector<DyadSampler> samplers;  // dyad counts given the G count
+    std::default_random_engine engine;
+    Accumulator L_L;
+    Accumulator L_G;
+
+    void draw(int replicates) {
+        for(int r = 0; r < replicates; ++r) {
+            Stats stats = samplers[counts(engine)](engine);
+            // same clamp as calc_L_L_or_L_G()
+            L_L.add((double)stats.LLs / std::max(stats.LGs, 1) + 1);
+            L_G.add((double)stats.GGs / std::max(stats.GLs, 1) + 1);
+        } // for
+    }  // draw()
+}; // Stratum
+
+// Stratified estimate of the L_L/L_G sweep for unfixed bernoulli chains, written with
+// the "_strat" suffix
+// Much of the spread of L_L between unfixed chains comes from their G count, so the
+// count b ~ Binomial(m, g_prob) is cut into up to 32 strata of consecutive counts with
+// about equal probability (counts below 1e-15 are dropped). A stratum draws b from the
+// binomial restricted to it and the dyad counts given b from DyadSampler. A pilot tenth
+// of the replicates (proportional, at least 2 per stratum) measures the spread s_k of
+// each stratum; the rest are allocated by Neyman, n_k proportional to W_k s_k, where s_k
+// averages the L_L and L_G deviations, each scaled by its sum over strata.
+// Input: args (Args) - generator options
+//        N (int) - replicates per n
+void run_stratified(const Args& args, int N) {
+    const int max_strata = 32;
+    std::vector<int> sizes = sweep_sizes(args);
+    std::vector<double> log_fact = log_factorials(args.n_max());
+    std::vector<double> L_L_means, L_L_sems, L_G_means, L_G_sems;
+
+    for(int n : sizes) {
+        int m = args.dimers() ? n / 2 : n;
+        std::vector<double> weights(m + 1);
+        double kept = 0;
+        for(int b = 0; b <= m; ++b) {
+            double log_w = log_fact[m] - log_fact[b] - log_fact[m - b] 
+                           + b * log(args.g_prob()) + (m - b) * log1p(-args.g_prob());
+            weights[b] = (log_w > log(1e-15)) ? exp(log_w) : 0;
+            kept += weights[b];
+        } // for
+
+        std::vector<Stratum> strata;
+        double mass = 0;
+        for(int b = 0, lo = -1; b <= m; ++b) {
+            if(weights[b] == 0) continue;
+            if(lo < 0) lo = b;
+            mass += weights[b];
+            bool last = (b == m || weights[b + 1] == 0);
+            if(last || mass >= kept * (strata.size() + 1) / max_strata) {
+                Stratum stratum;
+                stratum.lo = lo;
+                stratum.hi = b;
+                stratum.weight = 0;
+                for(int c = lo; c <= b; ++c) {
+                    stratum.weight += weights[c] / kept;
+                } // for
+                strata.push_back(std::move(stratum));
+                lo = -1;
+            } // if
+        } // for
+
+        parallel_for(strata.size(), args.threads(), [&](int k) {
+            Stratum& stratum = strata[k];
+            std::vector<double> counts(weights.begin() + stratum.lo, weights.begin() + stratum.hi + 1);
+            stratum.counts = AliasTable(counts);
+            for(int b = stratum.lo; b <= stratum.hi; ++b) {
+                stratum.samplers.push_back(DyadSampler::with_g_units(n, b, args.dimers(), args.cyclic(), log_fact));
+            } // for
+            stratum.engine = substream(args.seed(), n, -3 - k);
+        });
+
+        // pilot
+        std::vector<int> pilot(strata.size());
+        for(size_t k = 0; k < strata.size(); ++k) {
+            pilot[k] = std::max(2, (int)std::lround(N / 10.0 * strata[k].weight));
+        } // for
+        parallel_for(strata.size(), args.threads(), [&](int k) {
+            strata[k].draw(pilot[k]);
+        });
+
+        // Neyman allocation of the whole budget; strata already past their share keep the pilot
+        double L_L_spread = 0, L_G_spread = 0;
+        for(const Stratum& stratum : strata) {
+            L_L_spread += stratum.weight * sqrt(stratum.L_L.m2 / stratum.L_L.count);
+            L_G_spread += stratum.weight * sqrt(stratum.L_G.m2 / stratum.L_G.count);
+        } // for
+        std::vector<double> share(strata.size());
+        double total_share = 0;
+        for(size_t k = 0; k < strata.size(); ++k) {
+            const Stratum& stratum = strata[k];
+            double s_L = (L_L_spread > 0) ? sqrt(stratum.L_L.m2 / stratum.L_L.count) / L_L_spread : 0;
+            double s_G = (L_G_spread > 0) ? sqrt(stratum.L_G.m2 / stratum.L_G.count) / L_G_spread : 0;
+            share[k] = stratum.weight * (s_L + s_G) / 2;
+            total_share += share[k];
+        } // for
+        parallel_for(strata.size(), args.threads(), [&](int k) {
+            int target = (total_share > 0) ? (int)std::lround(N * share[k] / total_share) : 0;
+            strata[k].draw(std::max(target - pilot[k], 0));
+        });
+
+        double L_L_mean = 0, L_L_var = 0, L_G_mean = 0, L_G_var = 0;
+        for(const Stratum& stratum : strata) {
+            L_L_mean += stratum.weight * stratum.L_L.mean;
+            L_L_var += pow(stratum.weight * stratum.L_L.sem(), 2);
+            L_G_mean += stratum.weight * stratum.L_G.mean;
+            L_G_var += pow(stratum.weight * stratum.L_G.sem(), 2);
+        } // for
+        L_L_means.push_back(L_L_mean);
+        L_L_sems.push_back(sqrt(L_L_var));
+        L_G_means.push_back(L_G_mean);
+        L_G_sems.push_back(sqrt(L_G_var));
+    } // for
+
+    write_results(result_suffix(args), L_L_means, L_L_sems, L_G_means, L_G_sems);
+} // run_stratified()
+
+// Per-composition sums of L_L, L_L^2, L_G and L_G^2 over enumerated sequences
+struct EnumSums {
+    double L_L;
+    double L_L2;
+    double L_G;
+    double L_G2;
+}; // EnumSums
+
+// Largest number of generated monomers --enumerate will walk (2^32 sequences)
+const int max_enumerate_monomers = 32;
+
+// Calculate E[L_L], E[L_L^2], E[L_G] and E[L_G^2] by walking every sequence
+// The 2^m sequences of m monomers are visited in Gray-code order, so consecutive
+// sequences differ in one monomer and only the two dyads touching it change.
+// The top bits of the sequence are fixed per work item to split the walk over threads,
+// and sums are kept per G count so the fixed and unfixed weightings come from one pass.
+// Input: n, g_prob, fixed, dimers - same as gen()
+//        cyclic (bool) - count the ring-closing dyad
+//        threads (int) - number of worker threads
+Moments enumerate_moments(int n, 
+                          double g_prob, 
+                          bool fixed, 
+                          bool dimers, 
+                          bool cyclic, 
+                          int threads) {
+    int m = dimers ? n / 2 : n;
+    // bond i joins monomers i and i + 1; a ring adds bond m - 1 back to monomer 0
+    int bonds = (cyclic && m >= 2) ? m : std::max(m - 1, 0);
+    int low_bits = std::min(m, 20);
+    int prefixes = 1 << (m - low_bits);
+
+    std::vector<std::vector<EnumSums>> prefix_sums(prefixes, std::vector<EnumSums>(m + 1, {0, 0, 0, 0}));
+
+    parallel_for(prefixes, threads, [&](int prefix) {
+        std::vector<EnumSums>& sums = prefix_sums[prefix];
+        uint64_t x = (uint64_t)prefix << low_bits;
+
+        // dyad at bond i: 0 = LL, 1 = LG, 2 = GL, 3 = GG
+        auto dyad = [&](int i) {
+            int next = (i + 1 == m) ? 0 : i + 1;
+            return (int)(((x >> i) & 1) << 1 | ((x >> next) & 1));
+        };
+
+        int counts[4] = {0, 0, 0, 0};
+        for(int i = 0; i < bonds; ++i) {
+            counts[dyad(i)]++;
+        } // for
+        int Gs = __builtin_popcountll(x);
+
+        for(uint64_t k = 0; k < (1ull << low_bits); ++k) {
+            if(k > 0) {
+                // the flipped monomer's bonds to its neighbours
+                int j = __builtin_ctzll(k);
+                int before = (j > 0) ? j - 1 : (bonds == m ? m - 1 : -1);
+                int after = (j < bonds) ? j : -1;
+                if(before >= 0) counts[dyad(before)]--;
+                if(after >= 0) counts[dyad(after)]--;
+                x ^= 1ull << j;
+                Gs += ((x >> j) & 1) ? 1 : -1;
+                if(before >= 0) counts[dyad(before)]++;
+                if(after >= 0) counts[dyad(after)]++;
+            } // if
+
+            int LL = counts[0];
+            int GG = counts[3];
+            if(dimers) {
+                LL += m - Gs;
+                GG += Gs;
+            } // if
+            double L_L = (double)LL / (double)std::max(counts[1], 1) + 1;
+            double L_G = (double)GG / (double)std::max(counts[2], 1) + 1;
+
+            EnumSums& s = sums[Gs];
+            s.L_L += L_L;
+            s.L_L2 += L_L * L_L;
+            s.L_G += L_G;
+            s.L_G2 += L_G * L_G;
+        } // for
+    });
+
+    std::vector<EnumSums> sums(m + 1, {0, 0, 0, 0});
+    for(int prefix = 0; prefix < prefixes; ++prefix) {
+        for(int b = 0; b <= m; ++b) {
+            sums[b].L_L += prefix_sums[prefix][b].L_L;
+            sums[b].L_L2 += prefix_sums[prefix][b].L_L2;
+            sums[b].L_G += prefix_sums[prefix][b].L_G;
+            sums[b].L_G2 += prefix_sums[prefix][b].L_G2;
+        } // for
+    } // for
+
+    Moments moments = {0, 0, 0, 0};
+    for(int b = 0; b <= m; ++b) {
+        // probability of one particular sequence with b G's
+        double w;
+        if(fixed) {
+            int k = fixed_g_count(m, g_prob);
+            if(b != k) continue;
+            w = exp(lgamma(k + 1.0) + lgamma(m - k + 1.0) - lgamma(m + 1.0));
+        } else {
+            w = pow(g_prob, b) * pow(1 - g_prob, m - b);
+        } // if...else
+        moments.L_L += w * sums[b].L_L;
+        moments.L_L2 += w * sums[b].L_L2;
+        moments.L_G += w * sums[b].L_G;
+        moments.L_G2 += w * sums[b].L_G2;
+    } // for
+    return moments;
+} // enumerate_moments()
+
+// Compute the L_L/L_G sweep by exhaustive enumeration and write it with the "_e" suffix
+// Only feasible for short chains, e.g. --enumerate --n_min 2 --n_max 32 --n_step 1
+// Input: args (Args) - generator options
+//        N (int) - replicates per n of the equivalent sampled run
+void run_enumerate(const Args& args, int N) {
+    int max_n = args.dimers() ? 2 * max_enumerate_monomers + 1 : max_enumerate_monomers;
+    if(args.n_max() > max_n) {
+        std::cerr << "Error: --enumerate supports chains of at most " << max_n 
+                  << " monomers, set --n_max\n";
+        exit(1);
+    } // if
+
+    std::vector<double> L_L_means, L_L_sems, L_G_means, L_G_sems;
+    for(int n : sweep_sizes(args)) {
+        Moments m = enumerate_moments(n, args.g_prob(), args.fixed(), args.dimers(), args.cyclic(), args.threads());
+        L_L_means.push_back(m.L_L);
+        L_L_sems.push_back(sqrt(std::max(m.L_L2 - m.L_L * m.L_L, 0.0) / N));
+        L_G_means.push_back(m.L_G);
+        L_G_sems.push_back(sqrt(std::max(m.L_G2 - m.L_G * m.L_G, 0.0) / N));
+    } // for
+
+    write_results(result_suffix(args) + "_e", L_L_means, L_L_sems, L_G_means, L_G_sems);
+} // run_enumerate()
+
+// Names of the monomer types of the multi-monomer engine, in --monomers order
+// (L and G first so two types match the L/G engine, then e.g. caprolactone and TMC)
+const char monomer_names[] = "LGCTDEFH";
+
+// Chain of up to 8 monomer types packed log2(k) bits per monomer
+// Fields never straddle words: 64 / bits monomers per word, monomer 0 in the low bits
+struct PackedK {
+    int n = 0;
+    int bits = 1;
+    int per_word = 64;
+    std::vector<uint64_t> words;
+
+    // Reset to n monomers of type 0 with bits per monomer, keeping the allocation
+    void clear(int size, int width) {
+        n = size;
+        bits = width;
+        per_word = 64 / width;
+        words.assign((size + per_word - 1) / per_word, 0);
+    }  // clear()
+
+    int get(int i) const {
+        return (words[i / per_word] >> (i % per_word * bits)) & ((1u << bits) - 1);
+    }  // get()
+}; // PackedK
+
+// Bits needed per monomer for k types
+int type_bits(int k) {
+    return (k <= 2) ? 1 : (k <= 4) ? 2 : 3;
+} // type_bits()
+
+// Randomly generate polymer of length n with independent monomers of k types
+// Input: n (int) - length of polymer in monomers
+//        types (AliasTable) - distribution of the monomer type at each position
+//        bits (int) - bits per monomer (type_bits(k))
+//        dimers (bool) - each sampled type fills two consecutive positions (an odd
+//                        trailing monomer is dropped as in gen())
+//        engine (default_random_engine) - random source
+//        polymer (PackedK) - output, overwritten
+void gen_multi(int n, 
+               const AliasTable& types, 
+               int bits, 
+               bool dimers, 
+               std::default_random_engine& engine, 
+               PackedK& polymer) {
+    int width = dimers ? 2 : 1;
+    polymer.clear(n / width * width, bits);
+    int word = 0;
+    int shift = 0;
+    for(int i = 0; i + width <= n; i += width) {
+        uint64_t code = types(engine);
+        for(int j = 0; j < width; ++j) {
+            polymer.words[word] |= code << shift;
+            shift += bits;
+            if(shift + bits > 64) {
+                ++word;
+                shift = 0;
+            } // if
+        } // for
+    } // for
+} // gen_multi()
+
+// Count the k x k dyad matrix (counts[x * k + y] = number of x followed by y)
+// Each word is compared against every type at once: a field equals x when all its bits
+// match x, which leaves one flag bit per field, and a popcount of the flags of x in one
+// word against the flags of y in the word shifted by one monomer counts the xy dyads.
+// Input: polymer (PackedK) - chain to count
+//        k (int) - number of monomer types
+//        cyclic (bool) - also count the dyad closing the ring (last monomer to first)
+//        width (int) - monomers per generated unit, as in calc_stats()
+//        counts (vector<int>) - output, resized to k * k
+void calc_dyad_matrix(const PackedK& polymer, int k, bool cyclic, int width, std::vector<int>& counts) {
+    counts.assign(k * k, 0);
+    const int bits = polymer.bits;
+    const int per_word = polymer.per_word;
+    const int num_words = polymer.words.size();
+    const int dyads = polymer.n - 1;
+
+    // one flag bit at the lowest bit of every field
+    uint64_t low = 0;
+    for(int f = 0; f < per_word; ++f) {
+        low |= 1ull << (f * bits);
+    } // for
+
+    auto flags = [&](uint64_t w, int x) {
+        uint64_t same = ~(w ^ (low * x));
+        uint64_t all = same;
+        for(int b = 1; b < bits; ++b) {
+            all &= same >> b;
+        } // for
+        return all & low;
+    };
+
+    uint64_t first_flags[8];
+    uint64_t second_flags[8];
+    for(int w = 0; w < num_words && w * per_word < dyads; ++w) {
+        uint64_t first = polymer.words[w];
+        uint64_t second = first >> bits;
+        if(w + 1 < num_words) second |= (polymer.words[w + 1] & ((1ull << bits) - 1)) << ((per_word - 1) * bits);
+
+        int valid = std::min(per_word, dyads - w * per_word);
+        uint64_t mask = (valid == per_word) ? low : low & ((1ull << (valid * bits)) - 1);
+
+        for(int x = 0; x < k; ++x) {
+            first_flags[x] = flags(first, x) & mask;
+            second_flags[x] = flags(second, x);
+        } // for
+        for(int x = 0; x < k; ++x) {
+            for(int y = 0; y < k; ++y) {
+                counts[x * k + y] += __builtin_popcountll(first_flags[x] & second_flags[y]);
+            } // for
+        } // for
+    } // for
+
+    if(cyclic && polymer.n >= 2 * width) {
+        counts[polymer.get(polymer.n - 1) * k + polymer.get(0)]++;
+    } // if
+} // calc_dyad_matrix()
+
+// Run the L_x sweep for k monomer types and write data/L_<x>_{means,sems}_k<k><append>.txt
+// L_x = (x-x dyads) / max(x-other dyads, 1) + 1 generalizes L_L and L_G
+// Input: args (Args) - generator options with --monomers
+//        N (int) - replicates per n
+void run_multi(const Args& args, int N) {
+    const int k = args.monomers().size();
+    const int bits = type_bits(k);
+    AliasTable types(args.monomers());
+
+    std::vector<std::vector<double>> L_x_means(k), L_x_sems(k);
+
+    // blocks of replicates on their own substreams, merged in block order as in the
+    // sampled L/G sweep, so the results do not depend on the thread count
+    const int blocks = (N + sweep_block - 1) / sweep_block;
+
+    for(int n : sweep_sizes(args)) {
+        std::default_random_engine length_engine = substream(args.seed(), n, -1);
+        std::vector<int> lengths = replicate_lengths(args, n, N, length_engine);
+        std::vector<std::vector<Accumulator>> block_L_xs(blocks, std::vector<Accumulator>(k));
+
+        parallel_for(blocks, args.threads(), [&](int b) {
+            std::default_random_engine engine = substream(args.seed(), n, b);
+            PackedK polymer;
+            std::vector<int> counts;
+            for(int i = b * sweep_block; i < std::min(N, (b + 1) * sweep_block); ++i) {
+                gen_multi(lengths[i], types, bits, args.dimers(), engine, polymer);
+                calc_dyad_matrix(polymer, k, args.cyclic(), args.dimers() ? 2 : 1, counts);
+
+                for(int x = 0; x < k; ++x) {
+                    int stay = counts[x * k + x];
+                    int leave = std::accumulate(counts.begin() + x * k, counts.begin() + (x + 1) * k, 0) - stay;
+                    block_L_xs[b][x].add((double)stay / (double)std::max(leave, 1) + 1);
+                } // for
+            } // for
+        });
+
+        for(int x = 0; x < k; ++x) {
+            Accumulator L_x;
+            for(int b = 0; b < blocks; ++b) {
+                L_x.merge(block_L_xs[b][x]);
+            } // for
+            L_x_means[x].push_back(L_x.mean);
+            L_x_sems[x].push_back(L_x.sem());
+        } // for
+    } // for
+
+    std::string append = "_k" + std::to_string(k) + result_suffix(args);
+    std::cout << L_x_means[0].size() << std::endl;
+    for(int x = 0; x < k; ++x) {
+        std::string name(1, monomer_names[x]);
+        write_column("data/L_" + name + "_means" + append + ".txt", L_x_means[x]);
+        write_column("data/L_" + name + "_sems" + append + ".txt", L_x_sems[x]);
+    } // for
+} // run_multi()
+
+// Fenwick (binary indexed) tree of non-negative weights
+// O(log size) updates and O(log size) draws of an index proportional to its weight
+class Fenwick {
+private:
+    std::vector<double> _tree;
+    int _top;
+
+public:
+    explicit Fenwick(int size) : _tree(size + 1, 0.0), _top(1) {
+        while(_top * 2 <= size) _top *= 2;
+    }  // Fenwick()
+
+    void add(int i, double delta) {
+        for(++i; i < (int)_tree.size(); i += i & -i) {
+            _tree[i] += delta;
+        } // for
+    }  // add()
+
+    double total() const {
+        double sum = 0;
+        for(int i = _tree.size() - 1; i > 0; i -= i & -i) {
+            sum += _tree[i];
+        } // for
+        return sum;
+    }  // total()
+
+    // Smallest index whose prefix sum exceeds target (0 <= target < total())
+    int find(double target) const {
+        int pos = 0;
+        for(int step = _top; step > 0; step /= 2) {
+            if(pos + step < (int)_tree.size() && _tree[pos + step] <= target) {
+                pos += step;
+                target -= _tree[pos];
+            } // if
+        } // for
+        return std::min(pos, (int)_tree.size() - 2);
+    }  // find()
+}; // Fenwick
+
+// Ensemble of chains under transesterification (sequence scrambling)
+// Chains are generated with gen_polymer() and stored back to back in one word array.
+// Every ester bond reacts with the rate of its dyad type (--rates LL,LG,GL,GG): the
+// attacked chain swaps its tail after that bond with the same tail of a random partner
+// chain, which keeps every chain at n units while scrambling the sequences toward random.
+// Events are drawn Gillespie-style: the chain from a Fenwick tree over chain propensities
+// and the bond inside it by rejection against the fastest rate. Swapping the heads instead
+// of the tails yields the same pair of chains, so the shorter side is moved; the swap and
+// the dyad counts of the moved pieces are word operations, so an event costs
+// O(log chains + n / 64).
+class KmcEnsemble {
+private:
+    int _n;         // monomers per chain, as generated (an odd dimer chain drops one)
+    int _stride;    // words per chain
+    std::vector<double> _rates;
+    double _max_rate;
+    std::vector<uint64_t> _words;
+    std::vector<std::array<int, 4>> _counts;    // LL, LG, GL, GG of each chain
+    Fenwick _propensity;
+    double _time;
+
+    double chain_rate(const std::array<int, 4>& count) const {
+        return _rates[0] * count[0] + _rates[1] * count[1] + _rates[2] * count[2] + _rates[3] * count[3];
+    }  // chain_rate()
+
+    int bit(int c, int i) const {
+        return (int)((_words[(size_t)c * _stride + (i >> 6)] >> (i & 63)) & 1);
+    }  // bit()
+
+    // dyad type at bond i: 0 = LL, 1 = LG, 2 = GL, 3 = GG
+    int dyad(int c, int i) const {
+        return bit(c, i) << 1 | bit(c, i + 1);
+    }  // dyad()
+
+public:
+    // Input: args (Args) - generator options and --rates
+    //        n (int) - chain length in monomers
+    //        chains (int) - number of chains
+    //        engine (default_random_engine) - random source for the initial chains
+    KmcEnsemble(const Args& args, int n, int chains, std::default_random_engine& engine) 
+        : _rates(args.rates()), _counts(chains), _propensity(chains), _time(0) {
+        _max_rate = *std::max_element(_rates.begin(), _rates.end());
+        ChainTables tables(args);
+        Packed polymer;
+        for(int c = 0; c < chains; ++c) {
+            gen_polymer(args, tables, n, engine, polymer);
+            if(c == 0) {
+                _n = polymer.n;
+                _stride = (_n + 63) / 64;
+                _words.assign((size_t)chains * _stride, 0);
+            } // if
+            std::copy(polymer.words.begin(), polymer.words.end(), _words.begin() + (size_t)c * _stride);
+            Stats stats = calc_stats(polymer);
+            _counts[c] = {stats.LLs, stats.LGs, stats.GLs, stats.GGs};
+            _propensity.add(c, chain_rate(_counts[c]));
+        } // for
+    }  // KmcEnsemble()
+
+    double time() const {
+        return _time;
+    }  // time()
+
+    const std::vector<std::array<int, 4>>& counts() const {
+        return _counts;
+    }  // counts()
+
+    // Simulate one event
+    // Output: false if no event can happen (no reactive bond or partner)
+    bool step(std::default_random_engine& engine) {
+        const int chains = _counts.size();
+        const int n = _n;
+        double total = _propensity.total();
+        if(total <= 0 || chains < 2 || n < 2) return false;
+        std::uniform_real_distribution<double> unit(0.0, 1.0);
+        std::uniform_int_distribution<int> pick_bond(0, n - 2);
+        std::uniform_int_distribution<int> pick_partner(0, chains - 2);
+        _time -= log(1 - unit(engine)) / total;
+
+        int c = _propensity.find(unit(engine) * total);
+        int i;
+        do {
+            i = pick_bond(engine);
+        } while(unit(engine) * _max_rate >= _rates[dyad(c, i)]);
+
+        int d = pick_partner(engine);
+        if(d >= c) ++d;
+
+        // swap the monomers on the shorter side of bond i, moving their dyads along with them
+        uint64_t * cw = &_words[(size_t)c * _stride];
+        uint64_t * dw = &_words[(size_t)d * _stride];
+        bool heads = i + 1 < n / 2;
+        int lo = heads ? 0 : i + 1;
+        int hi = heads ? i + 1 : n;
+        Stats moved_c = heads ? count_dyads(cw, n, 0, i) : count_dyads(cw, n, i + 1, n - 1);
+        Stats moved_d = heads ? count_dyads(dw, n, 0, i) : count_dyads(dw, n, i + 1, n - 1);
+        std::array<int, 4> moved_diff = {moved_d.LLs - moved_c.LLs, moved_d.LGs - moved_c.LGs, 
+                                         moved_d.GLs - moved_c.GLs, moved_d.GGs - moved_c.GGs};
+        int old_c = dyad(c, i);
+        int old_d = dyad(d, i);
+        double old_rate_c = chain_rate(_counts[c]);
+        double old_rate_d = chain_rate(_counts[d]);
+
+        for(int w = lo >> 6; w * 64 < hi; ++w) {
+            uint64_t mask = ~0ull;
+            if(w == (lo >> 6)) mask &= ~0ull << (lo & 63);
+            if(hi - w * 64 < 64) mask &= (1ull << (hi - w * 64)) - 1;
+            uint64_t diff = (cw[w] ^ dw[w]) & mask;
+            cw[w] ^= diff;
+            dw[w] ^= diff;
+        } // for
+        int new_c = dyad(c, i);
+        int new_d = dyad(d, i);
+
+        for(int t = 0; t < 4; ++t) {
+            _counts[c][t] += moved_diff[t];
+            _counts[d][t] -= moved_diff[t];
+        } // for
+        _counts[c][old_c]--;
+        _counts[c][new_c]++;
+        _counts[d][old_d]--;
+        _counts[d][new_d]++;
+        _propensity.add(c, chain_rate(_counts[c]) - old_rate_c);
+        _propensity.add(d, chain_rate(_counts[d]) - old_rate_d);
+        return true;
+    }  // step()
+
+    // Number of chains whose tracked dyad counts differ from a full recount
+    int mismatches() const {
+        int wrong = 0;
+        for(size_t c = 0; c < _counts.size(); ++c) {
+            Stats stats = count_dyads(&_words[c * _stride], _n, 0, std::max(_n - 1, 0));
+            std::array<int, 4> recount = {stats.LLs, stats.LGs, stats.GLs, stats.GGs};
+            if(recount != _counts[c]) ++wrong;
+        } // for
+        return wrong;
+    }  // mismatches()
+}; // KmcEnsemble
+
+// Kinetic Monte Carlo of transesterification in an ensemble of chains (see KmcEnsemble)
+// Writes "events time L_L_mean L_L_sem L_G_mean L_G_sem" rows to data/kmc<append>.txt
+// Input: args (Args) - generator options, chain length --n_max, --kmc events, --rates
+//        chains (int) - number of chains in the ensemble
+void run_kmc(const Args& args, int chains) {
+    const long long events = args.kmc_events();
+    const int samples = 100;
+
+    KmcEnsemble ensemble(args, args.n_max(), chains, rng);
+
+    std::ofstream file("data/kmc" + result_suffix(args) + ".txt");
+    auto report = [&](long long done) {
+        std::vector<int> LL(chains), LG(chains), GL(chains), GG(chains);
+        for(int c = 0; c < chains; ++c) {
+            LL[c] = ensemble.counts()[c][0];
+            LG[c] = ensemble.counts()[c][1];
+            GL[c] = ensemble.counts()[c][2];
+            GG[c] = ensemble.counts()[c][3];
+        } // for
+        std::vector<double> L_Ls = calc_L_L_or_L_G(LL, LG);
+        std::vector<double> L_Gs = calc_L_L_or_L_G(GG, GL);
+        double L_L_mean = mean(L_Ls);
+        double L_G_mean = mean(L_Gs);
+        file << done << " " << ensemble.time() << " " << L_L_mean << " " << sem(L_Ls, L_L_mean) << " " 
+             << L_G_mean << " " << sem(L_Gs, L_G_mean) << "\n";
+    };
+
+    report(0);
+    for(long long event = 1; event <= events; ++event) {
+        if(!ensemble.step(rng)) break;
+        if(event % std::max(1LL, events / samples) == 0 || event == events) {
+            report(event);
+        } // if
+    } // for
+} // run_kmc()
+
+// L_L/L_G accumulators of N replicates at one n, drawn from the same substreams as the
+// sampled sweep, so a point matches the sweep row of a run with the same --seed
+// Input: point (Args) - generator options at the point (see Args::at_point())
+//        n (int) - degree of polymerization
+//        N (int) - replicates
+BlockResult sample_point(const Args& point, int n, int N) {
+    ChainTables tables(point);
+    DyadSampler sampler;
+    if(point.direct()) sampler = DyadSampler(n, point.g_prob(), point.dimers(), point.cyclic(), log_factorials(n));
+
+    std::default_random_engine length_engine = substream(point.seed(), n, -1);
+    std::vector<int> lengths = replicate_lengths(point, n, N, length_engine);
+
+    BlockResult result;
+    Packed polymer;
+    for(int b = 0; b * sweep_block < N; ++b) {
+        std::default_random_engine engine = substream(point.seed(), n, b);
+        BlockResult part;
+        for(int i = b * sweep_block; i < std::min(N, (b + 1) * sweep_block); ++i) {
+            Stats stats;
+            if(point.direct()) {
+                stats = sampler(engine);
+            } else {
+                gen_polymer(point, tables, lengths[i], engine, polymer);
+                stats = calc_stats(polymer, point.cyclic(), point.dimers() ? 2 : 1);
+            } // if...else
+            // same clamp as calc_L_L_or_L_G()
+            part.L_L.add((double)stats.LLs / std::max(stats.LGs, 1) + 1);
+            part.L_G.add((double)stats.GGs / std::max(stats.GLs, 1) + 1);
+        } // for
+        // merged in block order like SweepResults::add()
+        result.L_L.merge(part.L_L);
+        result.L_G.merge(part.L_G);
+    } // for
+    return result;
+} // sample_point()
+
+// Results of recently queried points with least-recently-used eviction
+// A point that is already being computed is not computed again: later requests for it
+// wait on the first one's future.
+class PointCache {
+private:
+    typedef std::tuple<int, double, bool, bool> Key;  // n, g_prob, fixed, dimers
+    typedef std::list<std::pair<Key, BlockResult>> Entries;
+
+    size_t _capacity;
+    std::mutex _mutex;
+    Entries _entries;  // most recently used first
+    std::map<Key, Entries::iterator> _index;
+    std::map<Key, std::shared_future<BlockResult>> _pending;
+
+public:
+    explicit PointCache(size_t capacity) : _capacity(capacity) {}
+
+    // Input: key - the point
+    //        compute (BlockResult()) - called on a miss, outside the lock
+    template <typename F>
+    BlockResult get(const Key& key, F compute) {
+        std::unique_lock<std::mutex> lock(_mutex);
+        auto hit = _index.find(key);
+        if(hit != _index.end()) {
+            _entries.splice(_entries.begin(), _entries, hit->second);
+            return hit->second->second;
+        } // if
+        auto pending = _pending.find(key);
+        if(pending != _pending.end()) {
+            std::shared_future<BlockResult> result = pending->second;
+            lock.unlock();
+            return result.get();
+        } // if
+
+        std::promise<BlockResult> promise;
+        _pending[key] = promise.get_future().share();
+        lock.unlock();
+        BlockResult result = compute();
+        lock.lock();
+        _entries.emplace_front(key, result);
+        _index[key] = _entries.begin();
+        if(_entries.size() > _capacity) {
+            _index.erase(_entries.back().first);
+            _entries.pop_back();
+        } // if
+        _pending.erase(key);
+        lock.unlock();
+        promise.set_value(result);
+        return result;
+    }  // get()
+}; // PointCache
+
+const size_t serve_cache_points = 4096;
+
+// Answer one query line "n g_prob [fixed [dimers]]" (fixed and dimers 0/1, defaulting
+// to the daemon's options) with "L_L L_L_sem L_G L_G_sem", or a line starting "error:"
+std::string answer_query(const Args& args, PointCache& cache, const std::string& line, int N) {
+    std::istringstream in(line);
+    int n;
+    double g_prob;
+    if(!(in >> n >> g_prob)) return "error: expected n g_prob [fixed [dimers]]\n";
+    bool fixed = args.fixed();
+    bool dimers = args.dimers();
+    std::vector<std::string> flags;
+    std::string flag;
+    while(in >> flag) {
+        if(flag != "0" && flag != "1") return "error: fixed and dimers are 0 or 1\n";
+        flags.push_back(flag);
+    } // while
+    if(flags.size() > 2) return "error: expected n g_prob [fixed [dimers]]\n";
+    if(flags.size() > 0) fixed = flags[0] == "1";
+    if(flags.size() > 1) dimers = flags[1] == "1";
+
+    if(n < 2 || n > 1000000) return "error: n must be between 2 and 1000000\n";
+    if(!(g_prob >= 0 && g_prob <= 1)) return "error: g_prob must be between 0 and 1\n";
+    if(fixed && (args.model() != Model::bernoulli || args.gradient() || !args.dimer_probs().empty())) {
+        return "error: fixed points only apply to the bernoulli model\n";
+    } // if
+    if(!dimers && !args.dimer_probs().empty()) return "error: --dimer_probs always feeds dimers\n";
+
+    Args point = args.at_point(g_prob, fixed, dimers);
+    BlockResult result = cache.get(std::make_tuple(n, g_prob, fixed, dimers), [&]() {
+        return sample_point(point, n, N);
+    });
+    char reply[128];
+    snprintf(reply, sizeof(reply), "%.17g %.17g %.17g %.17g\n", 
+             result.L_L.mean, result.L_L.sem(), result.L_G.mean, result.L_G.sem());
+    return reply;
+} // answer_query()
+
+// Query lines of all connections waiting for a worker of the serve daemon
+class QueryQueue {
+private:
+    std::mutex _mutex;
+    std::condition_variable _ready;
+    std::deque<std::packaged_task<std::string()>> _tasks;
+
+public:
+    // Queue the computation of one reply and return its future
+    template <typename F>
+    std::future<std::string> submit(F answer) {
+        std::packaged_task<std::string()> task(answer);
+        std::future<std::string> reply = task.get_future();
+        std::lock_guard<std::mutex> lock(_mutex);
+        _tasks.push_back(std::move(task));
+        _ready.notify_one();
+        return reply;
+    }  // submit()
+
+    // Wait for a queued task and take it
+    std::packaged_task<std::string()> take() {
+        std::unique_lock<std::mutex> lock(_mutex);
+        _ready.wait(lock, [&]() { return !_tasks.empty(); });
+        std::packaged_task<std::string()> task = std::move(_tasks.front());
+        _tasks.pop_front();
+        return task;
+    }  // take()
+}; // QueryQueue
+
+// Read the query lines of one connection until the client closes it
+// Every line read is queued for the workers and the replies are written back in query
+// order, so the connection only holds this reader while it waits on its client.
+void serve_connection(const Args& args, PointCache& cache, QueryQueue& queue, int fd, int N) {
+    std::string pending;
+    char buffer[4096];
+    ssize_t got;
+    while((got = read(fd, buffer, sizeof(buffer))) > 0) {
+        pending.append(buffer, got);
+        std::vector<std::future<std::string>> answers;
+        size_t start = 0;
+        for(size_t end; (end = pending.find('\n', start)) != std::string::npos; start = end + 1) {
+            std::string line = pending.substr(start, end - start);
+            if(line.find_first_not_of(" \t\r") == std::string::npos) continue;
+            answers.push_back(queue.submit([&args, &cache, line, N]() {
+                return answer_query(args, cache, line, N);
+            }));
+        } // for
+        pending.erase(0, start);
+        std::string replies;
+        for(std::future<std::string>& answer : answers) {
+            replies += answer.get();
+        } // for
+        for(size_t sent = 0; sent < replies.size(); ) {
+            ssize_t put = write(fd, replies.data() + sent, replies.size() - sent);
+            if(put <= 0) return;
+            sent += put;
+        } // for
+    } // while
+} // serve_connection()
+
+// Serve L_L/L_G points over the Unix socket args.serve() until killed
+// Each connection gets a reader thread that queues its query lines for a pool of
+// args.threads() workers, so idle or long-lived clients hold no worker and the queries
+// of all clients share the pool line by line. Points are sampled with the daemon's
+// generator options and --seed.
+// Input: args (Args) - generator options
+//        N (int) - replicates per point
+int run_serve(const Args& args, int N) {
+    sockaddr_un address = {};
+    address.sun_family = AF_UNIX;
+    if(args.serve().size() >= sizeof(address.sun_path)) {
+        std::cerr << "Error: socket path " << args.serve() << " is too long\n";
+        exit(1);
+    } // if
+    strcpy(address.sun_path, args.serve().c_str());
+
+    int listener = socket(AF_UNIX, SOCK_STREAM, 0);
+    unlink(address.sun_path);
+    if(listener < 0 || bind(listener, (sockaddr*)&address, sizeof(address)) != 0 || listen(listener, 64) != 0) {
+        std::cerr << "Error: cannot listen on " << args.serve() << ": " << strerror(errno) << "\n";
+        exit(1);
+    } // if
+    // a client hanging up mid-reply must not kill the daemon
+    signal(SIGPIPE, SIG_IGN);
+
+    PointCache cache(serve_cache_points);
+    QueryQueue queue;
+
+    std::vector<std::thread> workers;
+    for(int t = 0; t < args.threads(); ++t) {
+        workers.emplace_back([&]() {
+            for(;;) {
+                queue.take()();
+            } // for
+        });
+    } // for
+
+    std::cerr << "Serving L_L/L_G on " << args.serve() << "\n";
+    for(;;) {
+        int fd = accept(listener, nullptr, nullptr);
+        if(fd < 0) {
+            if(errno == EINTR) continue;
+            std::cerr << "Error: accept failed: " << strerror(errno) << "\n";
+            exit(1);
+        } // if
+        std::thread([&, fd]() {
+            serve_connection(args, cache, queue, fd, N);
+            close(fd);
+        }).detach();
+    } // for
+} // run_serve()
+
+// Interpolation surface: L_L/L_G tabulated on an (n, g_prob) grid for lookups without
+// simulation. Layout (native byte order, 8-byte aligned so it can be used through mmap):
+// SurfaceHeader, the n nodes and the g_prob nodes (double), then per node (n major)
+// L_L, L_G and their standard errors (float), then per grid cell the bilinear
+// interpolation error bounds of 1 / L_L and 1 / L_G (float).
+// L_L and L_G go roughly as 1 / g_prob and 1 / (1 - g_prob), so their reciprocals are
+// close to linear and are what gets interpolated; the standard errors are interpolated as is.
+const char surface_magic[8] = {'P', 'L', 'G', 'A', 'S', 'U', 'R', 'F'};
+const uint32_t surface_version = 1;
+
+struct SurfaceHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t n_count;
+    uint32_t g_count;
+    uint32_t exact;     // 1 if the nodes carry no Monte Carlo error
+    char suffix[48];    // result_suffix() of the run that built it
+}; // SurfaceHeader
+
+inline uint64_t surface_size(uint64_t n_count, uint64_t g_count) {
+    uint64_t cells = (n_count - 1) * (g_count - 1) * 2;
+    return sizeof(SurfaceHeader) + 8 * (n_count + g_count) + 4 * (n_count * g_count * 4 + cells + (cells & 1));
+} // surface_size()
+
+// Interpolated L_L/L_G with error bounds (one standard error plus the interpolation bound)
+struct SurfaceValue {
+    double L_L;
+    double L_G;
+    double L_L_err;
+    double L_G_err;
+}; // SurfaceValue
+
+// Read-only view of an interpolation surface, mapped into memory
+class Surface {
+private:
+    const char * _data;
+    size_t _size;
+    const SurfaceHeader * _header;
+    const double * _n;
+    const double * _g;
+    const float * _nodes;
+    const float * _cells;
+
+public:
+    explicit Surface(const std::string& path) {
+        int fd = open(path.c_str(), O_RDONLY);
+        struct stat info;
+        if(fd < 0 || fstat(fd, &info) != 0) {
+            std::cerr << "Error: cannot read " << path << "\n";
+            exit(1);
+        } // if
+        _size = info.st_size;
+        void* map = (_size >= sizeof(SurfaceHeader)) ? mmap(nullptr, _size, PROT_READ, MAP_PRIVATE, fd, 0) : MAP_FAILED;
+        close(fd);
+        if(map == MAP_FAILED) {
+            std::cerr << "Error: cannot map " << path << "\n";
+            exit(1);
+        } // if
+        _data = (const char*)map;
+        _header = (const SurfaceHeader*)_data;
+        if(std::memcmp(_header->magic, surface_magic, sizeof(surface_magic)) != 0 
+           || _header->version != surface_version || _header->n_count < 2 || _header->g_count < 2 
+           || surface_size(_header->n_count, _header->g_count) != _size) {
+            std::cerr << "Error: " << path << " is not an interpolation surface\n";
+            exit(1);
+        } // if
+        _n = (const double*)(_data + sizeof(SurfaceHeader));
+        _g = _n + _header->n_count;
+        _nodes = (const float*)(_g + _header->g_count);
+        _cells = _nodes + 4 * _header->n_count * _header->g_count;
+    }  // Surface()
+
+    Surface(const Surface&) = delete;
+    Surface& operator=(const Surface&) = delete;
+
+    ~Surface() {
+        munmap((void*)_data, _size);
+    }  // ~Surface()
+
+    // Result suffix of the run that built the surface
+    std::string suffix() const {
+        return std::string(_header->suffix, strnlen(_header->suffix, sizeof(_header->suffix)));
+    }  // suffix()
+
+    // Bilinear interpolation at (n, g_prob); NaN outside the grid
+    SurfaceValue operator()(double n, double g_prob) const {
+        const int n_count = _header->n_count;
+        const int g_count = _header->g_count;
+        if(!(n >= _n[0] && n <= _n[n_count - 1] && g_prob >= _g[0] && g_prob <= _g[g_count - 1])) {
+            return {NAN, NAN, NAN, NAN};
+        } // if
+        int i = std::min<int>(std::upper_bound(_n, _n + n_count, n) - _n, n_count - 1) - 1;
+        int j = std::min<int>(std::upper_bound(_g, _g + g_count, g_prob) - _g, g_count - 1) - 1;
+        double u = (n - _n[i]) / (_n[i + 1] - _n[i]);
+        double v = (g_prob - _g[j]) / (_g[j + 1] - _g[j]);
+
+        double value[4];
+        for(int c = 0; c < 4; ++c) {
+            auto node = [&](int a, int b) {
+                double x = _nodes[4 * ((i + a) * g_count + j + b) + c];
+                return (c < 2) ? 1 / x : x;
+            };
+            value[c] = (1 - u) * ((1 - v) * node(0, 0) + v * node(0, 1)) 
+                       + u * ((1 - v) * node(1, 0) + v * node(1, 1));
+        } // for
+        const float * cell = _cells + 2 * (i * (g_count - 1) + j);
+        double L_L = 1 / value[0];
+        double L_G = 1 / value[1];
+        // an error e in 1 / L is an error of about L^2 e in L
+        return {L_L, L_G, value[2] + L_L * L_L * cell[0], value[3] + L_G * L_G * cell[1]};
+    }  // operator()
+}; // Surface
+
+// Build the interpolation surface args.surface() over the sweep sizes and args.g_nodes()
+// g_prob nodes, exactly with --exact and otherwise from N sampled replicates per node
+// Sampled nodes at the same n share their substreams, so the noise is correlated along
+// g_prob and the surface stays smooth in that direction.
+// Input: args (Args) - generator options
+//        N (int) - replicates per node
+void run_surface(const Args& args, int N) {
+    const std::vector<int> sizes = sweep_sizes(args);
+    const int n_count = sizes.size();
+    const int g_count = args.g_nodes();
+    std::vector<double> g_nodes(g_count);
+    for(int j = 0; j < g_count; ++j) {
+        g_nodes[j] = (double)j / (g_count - 1);
     } // for
-    file.close();
+
+    std::vector<double> log_fact;
+    if(args.exact()) log_fact = log_factorials(sizes.back());
+
+    // largest chains first so the expensive nodes do not trail at the end
+    std::vector<float> nodes(4 * n_count * g_count);
+    parallel_for(n_count * g_count, args.threads(), [&](int item) {
+        int i = n_count - 1 - item / g_count;
+        int j = item % g_count;
+        float * node = &nodes[4 * (i * g_count + j)];
+        if(args.exact()) {
+            Moments m = exact_point(args.at_point(g_nodes[j], args.fixed(), args.dimers()), sizes[i], log_fact);
+            node[0] = m.L_L;
+            node[1] = m.L_G;
+            node[2] = node[3] = 0;
+        } else {
+            BlockResult result = sample_point(args.at_point(g_nodes[j], args.fixed(), args.dimers()), sizes[i], N);
+            node[0] = result.L_L.mean;
+            node[1] = result.L_G.mean;
+            node[2] = result.L_L.sem();
+            node[3] = result.L_G.sem();
+        } // if...else
+    });
+
+    // Bilinear interpolation of 1 / L is off by at most h^2/8 times its second derivative
+    // along each axis. h^2 f'' is estimated by the largest second difference over the
+    // cell and its neighbours, doubled for safety. No difference can see the curvature
+    // near an edge (1 / L_L bends from 1 / n to g_prob within the first g_prob cell of long
+    // chains, and the max(LG, 1) clamp bends it again near g_prob = 1), so the two cells
+    // nearest each edge are also bounded by the change of 1 / L across the cell, which
+    // holds for any monotone 1 / L.
+    auto axis_bound = [&](int i, int j, int c, bool along_n) {
+        int count = along_n ? n_count : g_count;
+        int k = along_n ? i : j;
+        // 1 / L at position p along the axis, on side 0 or 1 of the cell
+        auto f = [&](int p, int side) {
+            int x = along_n ? p : i + side;
+            int y = along_n ? j + side : p;
+            return 1.0 / nodes[4 * (x * g_count + y) + c];
+        };
+        double bound = 0;
+        for(int side = 0; side < 2; ++side) {
+            for(int p = std::max(k - 1, 1); count >= 3 && p <= std::min(k + 2, count - 2); ++p) {
+                bound = std::max(bound, fabs(f(p - 1, side) - 2 * f(p, side) + f(p + 1, side)) / 4);
+            } // for
+            if(k <= 1 || k + 3 >= count) bound = std::max(bound, fabs(f(k + 1, side) - f(k, side)));
+        } // for
+        return bound;
+    };
+    std::vector<float> cells(2 * (n_count - 1) * (g_count - 1));
+    for(int i = 0; i + 1 < n_count; ++i) {
+        for(int j = 0; j + 1 < g_count; ++j) {
+            for(int c = 0; c < 2; ++c) {
+                cells[2 * (i * (g_count - 1) + j) + c] = axis_bound(i, j, c, true) + axis_bound(i, j, c, false);
+            } // for
+        } // for
+    } // for
+    if(cells.size() & 1) cells.push_back(0);
+
+    std::ofstream file(args.surface(), std::ios::binary);
+    if(!file) {
+        std::cerr << "Error: cannot write " << args.surface() << "\n";
+        exit(1);
+    } // if
+    SurfaceHeader header = {};
+    std::memcpy(header.magic, surface_magic, sizeof(surface_magic));
+    header.version = surface_version;
+    header.n_count = n_count;
+    header.g_count = g_count;
+    header.exact = args.exact();
+    strncpy(header.suffix, result_suffix(args).c_str(), sizeof(header.suffix) - 1);
+    std::vector<double> n_nodes(sizes.begin(), sizes.end());
+    file.write((const char*)&header, sizeof(header));
+    file.write((const char*)n_nodes.data(), n_nodes.size() * sizeof(double));
+    file.write((const char*)g_nodes.data(), g_nodes.size() * sizeof(double));
+    file.write((const char*)nodes.data(), nodes.size() * sizeof(float));
+    file.write((const char*)cells.data(), cells.size() * sizeof(float));
+    std::cout << n_count << " x " << g_count << std::endl;
+} // run_surface()
+
+// gen lookup <surface> [n g_prob ...]: print "L_L L_L_err L_G L_G_err" for each point,
+// read from stdin when none are given
+int run_lookup(const std::vector<std::string>& argv) {
+    if(argv.empty() || argv.size() % 2 == 0) {
+        std::cerr << "Error: lookup takes a surface file and n g_prob pairs\n";
+        return 1;
+    } // if
+    Surface surface(argv[0]);
+    auto print = [&](double n, double g_prob) {
+        SurfaceValue value = surface(n, g_prob);
+        std::cout << value.L_L << " " << value.L_L_err << " " << value.L_G << " " << value.L_G_err << "\n";
+    };
+    if(argv.size() > 1) {
+        for(size_t i = 1; i < argv.size(); i += 2) {
+            print(std::stod(argv[i]), std::stod(argv[i + 1]));
+        } // for
+    } else {
+        double n, g_prob;
+        while(std::cin >> n >> g_prob) {
+            print(n, g_prob);
+        } // while
+    } // if...else
+    return 0;
+} // run_lookup()
+
+// Regression checks of the engines against each other, one "ok"/"FAIL" line per check
+// Every packed generator must build the chain length of the string gen() (an odd dimer
+// chain drops its last monomer), the packed calc_stats() must count the dyads of the
+// string one, and the sampled and direct sweeps must match --exact, itself matched
+// against --enumerate, at even and odd n with and without dimers, down to chains of a
+// single dimer (a ring of one unit has no closing dyad). Polydisperse (Flory)
+// sweeps, whose odd lengths exercise the same dimer path, must match the mean of the
+// exact values over their replicate lengths, and the dyad counts KmcEnsemble tracks must
+// still agree with a full recount after 10^5 events. The serve daemon's query parser must
+// reject malformed lines (e.g. a fixed flag of 2). Sampled means pass within 4.5 SEM, so
+// a sound tree fails a check about once in 10^4 runs.
+// Input: args (Args) - g_prob, model, ratios, cyclic and seed to check
+//        N (int) - replicates per sampled point
+// Output: 0 if every check passed, 1 otherwise
+int run_self_check(const Args& args, int N) {
+    const bool bernoulli = args.model() == Model::bernoulli;
+    const double g_prob = args.g_prob();
+    int failures = 0;
+    auto report = [&](bool ok, const std::string& check) {
+        std::cout << (ok ? "ok    " : "FAIL  ") << check << "\n";
+        if(!ok) ++failures;
+    };
+    auto describe = [&](const char * check, int n, bool fixed, bool dimers) {
+        std::ostringstream out;
+        out << check << " n=" << n << (fixed ? " fixed" : "") << (dimers ? " dimers" : "");
+        return out.str();
+    };
+    auto agrees = [](const Accumulator& sampled, double exact) {
+        return std::fabs(sampled.mean - exact) <= 4.5 * sampled.sem() + 1e-9 * std::fabs(exact);
+    };
+
+    // chain lengths of every packed generator and dyad counts against the string engine
+    std::default_random_engine engine = substream(args.seed(), 0, 0);
+    std::uniform_int_distribution<int> length(2, 300);
+    Gradient gradient(args);
+    gradient.starts = {0};
+    gradient.models = {run_model(args, g_prob)};
+    AliasTable dimer_types({1, 1, 1, 1});
+    std::vector<uint32_t> zeros(300, 0);
+    bool lengths_ok = true, stats_ok = true;
+    Packed polymer;
+    for(int chain = 0; chain < 2000; ++chain) {
+        int n = length(engine);
+        bool fixed = chain & 1;
+        bool dimers = chain & 2;
+        std::string reference = gen(n, g_prob, fixed, dimers);
+        int size = reference.size();
+
+        gen(n, g_prob, fixed, dimers, engine, polymer);
+        lengths_ok &= polymer.n == size;
+        gen_markov(n, run_model(args, g_prob), dimers, engine, polymer);
+        lengths_ok &= polymer.n == size;
+        gen_gradient(n, gradient, dimers, engine, polymer);
+        lengths_ok &= polymer.n == size;
+        gen_qmc(n, g_prob, dimers, zeros.data(), zeros.data(), polymer);
+        lengths_ok &= polymer.n == size;
+        if(dimers) {
+            gen_heterodimers(n, dimer_types, engine, polymer);
+            lengths_ok &= polymer.n == size;
+        } // if
+
+        polymer.clear(size);
+        for(int i = 0; i < size; ++i) {
+            if(reference[i] == 'G') polymer.set(i);
+        } // for
+        Stats packed = calc_stats(polymer);
+        Stats string = calc_stats(reference);
+        stats_ok &= packed.GGs == string.GGs && packed.LLs == string.LLs && packed.GLs == string.GLs 
+                    && packed.LGs == string.LGs && packed.Gs == string.Gs && packed.Ls == string.Ls;
+        // the ring adds the bond from the last monomer back to the first
+        Stats ring = calc_stats(polymer, true);
+        string = calc_stats(reference + reference[0]);
+        stats_ok &= ring.GGs == string.GGs && ring.LLs == string.LLs && ring.GLs == string.GLs 
+                    && ring.LGs == string.LGs;
+    } // for
+    report(lengths_ok, "packed chain lengths match the string gen() (2000 chains)");
+    report(stats_ok, "packed calc_stats() matches the string calc_stats() (2000 chains)");
+
+    // sampled, direct and enumerated sweeps against the exact moments
+    std::vector<double> log_fact = log_factorials(64);
+    for(int n : {2, 3, 14, 15, 40, 41}) {
+        for(int fixed = 0; fixed <= (bernoulli ? 1 : 0); ++fixed) {
+            for(int dimers = 0; dimers <= 1; ++dimers) {
+                Args point = args.at_point(g_prob, fixed, dimers);
+                Moments exact = exact_point(point, n, log_fact);
+
+                if(bernoulli && n <= 15) {
+                    Moments walked = enumerate_moments(n, g_prob, fixed, dimers, args.cyclic(), args.threads());
+                    report(std::fabs(walked.L_L - exact.L_L) <= 1e-9 * exact.L_L 
+                           && std::fabs(walked.L_G - exact.L_G) <= 1e-9 * exact.L_G, 
+                           describe("enumerate = exact", n, fixed, dimers));
+                } // if
+
+                BlockResult sampled = sample_point(point, n, N);
+                report(agrees(sampled.L_L, exact.L_L) && agrees(sampled.L_G, exact.L_G), 
+                       describe("sampled ~ exact", n, fixed, dimers));
+
+                if(fixed) {
+                    DyadSampler sampler(n, g_prob, dimers, args.cyclic(), log_fact);
+                    std::default_random_engine direct_engine = substream(args.seed(), n, 0);
+                    BlockResult direct;
+                    for(int i = 0; i < N; ++i) {
+                        Stats stats = sampler(direct_engine);
+                        direct.L_L.add((double)stats.LLs / std::max(stats.LGs, 1) + 1);
+                        direct.L_G.add((double)stats.GGs / std::max(stats.GLs, 1) + 1);
+                    } // for
+                    report(agrees(direct.L_L, exact.L_L) && agrees(direct.L_G, exact.L_G), 
+                           describe("direct ~ exact", n, fixed, dimers));
+                } // if
+            } // for
+        } // for
+    } // for
+
+    // Flory lengths about an odd mean: the expected mean is that of the exact values of
+    // the drawn lengths, which the sweep shares through their substream
+    for(int n : {15, 41}) {
+        for(int fixed = 0; fixed <= (bernoulli ? 1 : 0); ++fixed) {
+            for(int dimers = 0; dimers <= 1; ++dimers) {
+                Args point = args.at_point(g_prob, fixed, dimers).with_lengths(LengthDist::flory);
+                std::default_random_engine length_engine = substream(args.seed(), n, -1);
+                std::vector<int> lengths = replicate_lengths(point, n, N, length_engine);
+                std::vector<double> lengths_fact = log_factorials(lengths.back());
+                std::map<int, Moments> exact;
+                double L_L = 0, L_G = 0;
+                for(int size : lengths) {
+                    if(!exact.count(size)) exact[size] = exact_point(point, size, lengths_fact);
+                    L_L += exact[size].L_L / N;
+                    L_G += exact[size].L_G / N;
+                } // for
+                BlockResult sampled = sample_point(point, n, N);
+                report(agrees(sampled.L_L, L_L) && agrees(sampled.L_G, L_G), 
+                       describe("flory lengths ~ exact", n, fixed, dimers));
+            } // for
+        } // for
+    } // for
+
+    // the serve daemon must answer well-formed queries and reject malformed ones
+    PointCache cache(16);
+    bool queries_ok = answer_query(args, cache, "40 0.25", 100).compare(0, 6, "error:") != 0;
+    if(bernoulli) queries_ok &= answer_query(args, cache, "40 0.25 1 0", 100).compare(0, 6, "error:") != 0;
+    for(const char * query : {"40", "40 0.25 2", "40 0.25 -7", "40 0.25 1 3", "40 0.25 0.5", "40 0.25 x", 
+                              "40 0.25 0 0 1", "1 0.25", "40 1.5"}) {
+        queries_ok &= answer_query(args, cache, query, 100).compare(0, 6, "error:") == 0;
+    } // for
+    report(queries_ok, "serve queries are answered or rejected");
+
+    // transesterification must keep the tracked dyad counts of every chain exact
+    for(int n : {128, 129}) {
+        for(int dimers = 0; dimers <= 1; ++dimers) {
+            std::default_random_engine kmc_engine = substream(args.seed(), n, 0);
+            KmcEnsemble ensemble(args.at_point(g_prob, false, dimers), n, 200, kmc_engine);
+            for(int event = 0; event < 100000 && ensemble.step(kmc_engine); ++event) {}
+            report(ensemble.mismatches() == 0, describe("kmc counts = recount", n, false, dimers));
+        } // for
+    } // for
+
+    std::cout << (failures ? std::to_string(failures) + " checks failed" : "all checks passed") << std::endl;
+    return failures ? 1 : 0;
+} // run_self_check()
+
+int main(int argc, char *argv[]) {
+    std::ios_base::sync_with_stdio(false);
+
+    // gen merge <partial files>: combine the results of a sharded run
+    if(argc >= 2 && std::string(argv[1]) == "merge") {
+        return run_merge(std::vector<std::string>(argv + 2, argv + argc));
+    } // if
+
+    // gen lookup <surface> [n g_prob ...]: interpolate a surface built with --surface
+    if(argc >= 2 && std::string(argv[1]) == "lookup") {
+        return run_lookup(std::vector<std::string>(argv + 2, argv + argc));
+    } // if
+
+    Args args(argc, argv);
+    rng.seed(args.seed());
+    int N = 10000;
+
+    if(!args.load().empty()) {
+        run_load(args);
+        return 0;
+    } // if
+
+    if(args.self_check()) return run_self_check(args, N);
+
+    if(!args.serve().empty()) return run_serve(args, N);
+
+    if(!args.surface().empty()) {
+        run_surface(args, N);
+        return 0;
+    } // if
+
+    if(!args.fit().empty()) {
+        run_fit(args);
+        return 0;
+    } // if
+
+    if(args.exact()) {
+        run_exact(args, N);
+        return 0;
+    } // if
+
+    if(args.enumerate()) {
+        run_enumerate(args, N);
+        return 0;
+    } // if
+
+    if(args.kmc_events() > 0) {
+        run_kmc(args, N);
+        return 0;
+    } // if
+
+    if(!args.monomers().empty()) {
+        run_multi(args, N);
+        return 0;
+    } // if
+
+    if(args.stratified()) {
+        run_stratified(args, N);
+        return 0;
+    } // if
+
+    SweepResults results;
+
+    std::vector<double> log_fact;
+    if(args.direct()) log_fact = log_factorials(args.n_max());
+
+    ChainTables tables(args);
+
+    // k-mer fractions: per-n sums and sums of squares over replicates
+    const int k = args.kmers();
+    const int codes = k ? 1 << k : 0;
+    std::vector<std::vector<double>> kmer_means, kmer_sems;
+    std::vector<RunHistogram> run_hists;
+    std::vector<Distribution> L_L_dists, L_G_dists;
+    std::vector<BootstrapCI> L_L_cis, L_G_cis;
+    std::vector<double> dL_L_means, dL_L_sems, dL_G_means, dL_G_sems;
+    std::vector<const Metric*> metrics = find_metrics(args.metrics());
+
+    // Replicates are generated in blocks spread over the threads, each block with its own
+    // engine seeded from (run seed, n, block) and its own accumulators, merged in block
+    // order so the results depend on neither the thread count nor the shard split
+    const int blocks = (N + sweep_block - 1) / sweep_block;
+    const std::vector<int> sizes = sweep_sizes(args);
+
+    std::unique_ptr<StoreWriter> store;
+    if(!args.store().empty()) {
+        store.reset(new StoreWriter(args.store(), result_suffix(args), sizes.size()));
+    } // if
+
+    // a shard owns every shard_count-th (n, block) unit and writes its block results
+    std::ofstream partial;
+    if(args.sharded()) {
+        std::string path = "data/shard" + result_suffix(args) + "_" + std::to_string(args.shard_index()) 
+                           + "of" + std::to_string(args.shard_count()) + ".bin";
+        partial.open(path, std::ios::binary);
+        if(!partial) {
+            std::cerr << "Error: cannot write " << path << "\n";
+            exit(1);
+        } // if
+        write_shard_header(partial, {args.seed(), args.shard_index(), args.shard_count(), N, sweep_block, 
+                                     args.covariance(), result_suffix(args), generator_options(args), sizes, 
+                                     args.metrics()});
+    } // if
+    auto owns = [&](int n_index, int b) {
+        return (n_index * blocks + b) % args.shard_count() == args.shard_index();
+    };
+
+    // --qmc: every block is the first sweep_block points of the Sobol sequence, in Gray-code
+    // order, with its own Owen scrambling seeds, so blocks are independent randomizations
+    Sobol sobol;
+    const int width = args.dimers() ? 2 : 1;
+
+    for(int n_index = 0; n_index < (int)sizes.size(); ++n_index) {
+        const int n = sizes[n_index];
+        DyadSampler sampler;
+        if(args.direct()) sampler = DyadSampler(n, args.g_prob(), args.dimers(), args.cyclic(), log_fact);
+
+        std::default_random_engine length_engine = substream(args.seed(), n, -1);
+        std::vector<int> lengths = replicate_lengths(args, n, N, length_engine);
+
+        std::vector<Stats> stats(N);
+        BlockResult empty;
+        empty.metrics.resize(metrics.size());
+        std::vector<BlockResult> block_results(blocks, empty);
+        std::vector<std::vector<double>> kmer_sum(blocks, std::vector<double>(codes, 0.0));
+        std::vector<std::vector<double>> kmer_sum2(kmer_sum);
+        std::vector<RunHistogram> block_runs(blocks, RunHistogram(args.runs()));
+        std::vector<Distribution> block_L_L(args.quantiles() ? blocks : 0, Distribution(n));
+        std::vector<Distribution> block_L_G(block_L_L);
+        std::vector<CoMoments<score_size>> block_scores(args.sensitivity() ? blocks : 0);
+        if(args.qmc()) sobol.reserve(lengths.back() / width);
+
+        parallel_for(blocks, args.threads(), [&](int b) {
+            if(!owns(n_index, b)) return;
+            std::default_random_engine engine = substream(args.seed(), n, b);
+            Packed polymer;
+            std::vector<int> kmer_counts;
+
+            std::vector<uint32_t> point, seeds;
+            if(args.qmc()) {
+                point.assign(sobol.dims(), 0);
+                uint64_t high = engine();
+                SplitMix64 scramble(high << 32 ^ engine());
+                for(int j = 0; j < sobol.dims(); ++j) {
+                    seeds.push_back(scramble() >> 32);
+                } // for
+            } // if
+
+            for(int i = b * sweep_block; i < std::min(N, (b + 1) * sweep_block); ++i) {
+                if(args.direct()) {
+                    stats[i] = sampler(engine);
+                } else if(args.qmc()) {
+                    // each point differs from the one before by one direction number per dimension
+                    size_t point_index = i - b * sweep_block;
+                    if(point_index > 0) {
+                        int c = __builtin_ctzll(point_index);
+                        for(size_t j = 0; j < point.size(); ++j) {
+                            point[j] ^= sobol(j, c);
+                        } // for
+                    } // if
+                    gen_qmc(lengths[i], args.g_prob(), args.dimers(), point.data(), seeds.data(), polymer);
+                    stats[i] = calc_stats(polymer, args.cyclic(), width);
+                } else {
+                    gen_polymer(args, tables, lengths[i], engine, polymer);
+                    stats[i] = calc_stats(polymer, args.cyclic(), width);
+                } // if...else
+
+                // same clamp as calc_L_L_or_L_G()
+                double L_L = (double)stats[i].LLs / std::max(stats[i].LGs, 1) + 1;
+                double L_G = (double)stats[i].GGs / std::max(stats[i].GLs, 1) + 1;
+                BlockResult& result = block_results[b];
+                result.L_L.add(L_L);
+                result.L_G.add(L_G);
+                for(size_t m = 0; m < metrics.size(); ++m) {
+                    result.metrics[m].add(metrics[m]->value(stats[i]));
+                } // for
+                if(args.covariance()) result.covariance.add(covariance_values(stats[i]));
+                if(args.quantiles()) {
+                    block_L_L[b].add(L_L);
+                    block_L_G[b].add(L_G);
+                } // if
+                if(args.sensitivity()) block_scores[b].add(score_values(stats[i], args.g_prob(), args.dimers()));
+                if(args.direct()) continue;
+
+                if(k) {
+                    int total = count_kmers(polymer, k, args.cyclic(), kmer_counts);
+                    for(int c = 0; total > 0 && c < codes; ++c) {
+                        double fraction = (double)kmer_counts[c] / total;
+                        kmer_sum[b][c] += fraction;
+                        kmer_sum2[b][c] += fraction * fraction;
+                    } // for
+                } // if
+                if(args.runs()) count_runs(polymer, args.cyclic(), block_runs[b]);
+            } // for
+        });
+
+        if(args.sharded()) {
+            for(int b = 0; b < blocks; ++b) {
+                if(owns(n_index, b)) write_block_result(partial, n_index, b, block_results[b], args.covariance());
+            } // for
+            continue;
+        } // if
+
+        if(store) store->add(n, stats);
+        results.add(block_results, metrics.size(), args.qmc());
+
+        if(args.bootstrap()) {
+            std::vector<int> LL_stats(N), LG_stats(N), GG_stats(N), GL_stats(N);
+            for(int i = 0; i < N; ++i) {
+                LL_stats[i] = stats[i].LLs;
+                LG_stats[i] = stats[i].LGs;
+                GG_stats[i] = stats[i].GGs;
+                GL_stats[i] = stats[i].GLs;
+            } // for
+            std::default_random_engine boot_engine = substream(args.seed(), n, -2);
+            uint64_t boot_seed = (uint64_t)boot_engine() << 32 | boot_engine();
+            std::vector<BootstrapCI> cis = bootstrap_means({calc_L_L_or_L_G(LL_stats, LG_stats), 
+                                                            calc_L_L_or_L_G(GG_stats, GL_stats)}, 
+                                                           args.bootstrap(), 0.95, args.threads(), boot_seed);
+            L_L_cis.push_back(cis[0]);
+            L_G_cis.push_back(cis[1]);
+        } // if
+
+        if(k) {
+            // same estimator as sem(): population deviation over sqrt(N - 1)
+            kmer_means.emplace_back(codes);
+            kmer_sems.emplace_back(codes);
+            for(int c = 0; c < codes; ++c) {
+                double sum = 0, sum2 = 0;
+                for(int b = 0; b < blocks; ++b) {
+                    sum += kmer_sum[b][c];
+                    sum2 += kmer_sum2[b][c];
+                } // for
+                double m = sum / N;
+                kmer_means.back()[c] = m;
+                kmer_sems.back()[c] = sqrt(std::max(sum2 / N - m * m, 0.0) / (N - 1));
+            } // for
+        } // if
+
+        if(args.runs()) {
+            run_hists.emplace_back(args.runs());
+            for(const RunHistogram& hist : block_runs) {
+                run_hists.back().merge(hist);
+            } // for
+        } // if
+
+        if(args.quantiles()) {
+            L_L_dists.emplace_back(n);
+            L_G_dists.emplace_back(n);
+            for(int b = 0; b < blocks; ++b) {
+                L_L_dists.back().merge(block_L_L[b]);
+                L_G_dists.back().merge(block_L_G[b]);
+            } // for
+        } // if
+
+        if(args.sensitivity()) {
+            CoMoments<score_size> scores;
+            for(const CoMoments<score_size>& block_moments : block_scores) {
+                scores.merge(block_moments);
+            } // for
+            double value, error;
+            score_derivative(scores, 0, value, error);
+            dL_L_means.push_back(value);
+            dL_L_sems.push_back(error);
+            score_derivative(scores, 1, value, error);
+            dL_G_means.push_back(value);
+            dL_G_sems.push_back(error);
+        } // if
+    } // for
+
+    if(args.sharded()) return 0;
+
+    results.write(result_suffix(args), sizes, metrics, args.covariance());
+    if(args.sensitivity()) {
+        write_column("data/dL_L_dg_means" + result_suffix(args) + ".txt", dL_L_means);
+        write_column("data/dL_L_dg_sems" + result_suffix(args) + ".txt", dL_L_sems);
+        write_column("data/dL_G_dg_means" + result_suffix(args) + ".txt", dL_G_means);
+        write_column("data/dL_G_dg_sems" + result_suffix(args) + ".txt", dL_G_sems);
+    } // if
+    if(k) {
+        write_kmers("data/kmers_k" + std::to_string(k) + result_suffix(args) + ".txt", 
+                    k, sizes, kmer_means, kmer_sems);
+    } // if
+    if(args.runs()) {
+        write_runs("data/runs" + result_suffix(args) + ".txt", sizes, run_hists);
+    } // if
+    if(args.bootstrap()) {
+        write_intervals("data/L_L_ci" + result_suffix(args) + ".txt", sizes, results.L_L_means, L_L_cis);
+        write_intervals("data/L_G_ci" + result_suffix(args) + ".txt", sizes, results.L_G_means, L_G_cis);
+    } // if
+    if(args.quantiles()) {
+        write_distributions("L_L", result_suffix(args), sizes, L_L_dists);
+        write_distributions("L_G", result_suffix(args), sizes, L_G_dists);
+    } // if
 } // main()
\ No newline at end of file
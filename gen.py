@@ -90,6 +90,80 @@ def calc_ratio(polymer: str):
     
     return num_Gs / num_Ls
 
+def load_surface(path: str):
+    """
+    Load an interpolation surface written by `gen --surface path`
+
+    Args:
+        path (str): surface file
+
+    Returns:
+        dict: n and g_prob nodes, per-node L_L, L_G and their SEMs, per-cell
+            interpolation bounds of 1 / L_L and 1 / L_G, and the run suffix
+    """
+    data = np.fromfile(path, dtype=np.uint8)
+    header = np.dtype([('magic', 'S8'), ('version', '<u4'), ('n_count', '<u4'), 
+                       ('g_count', '<u4'), ('exact', '<u4'), ('suffix', 'S48')])
+    h = np.frombuffer(data, dtype=header, count=1)[0]
+    if h['magic'] != b'PLGASURF' or h['version'] != 1:
+        raise ValueError(f"{path} is not an interpolation surface")
+
+    n_count, g_count = int(h['n_count']), int(h['g_count'])
+    offset = header.itemsize
+    n = np.frombuffer(data, dtype='<f8', count=n_count, offset=offset)
+    offset += 8 * n_count
+    g = np.frombuffer(data, dtype='<f8', count=g_count, offset=offset)
+    offset += 8 * g_count
+    nodes = np.frombuffer(data, dtype='<f4', count=4 * n_count * g_count, offset=offset)
+    offset += 4 * nodes.size
+    cells = np.frombuffer(data, dtype='<f4', count=2 * (n_count - 1) * (g_count - 1), offset=offset)
+
+    nodes = nodes.reshape(n_count, g_count, 4).astype(float)
+    return {
+        'n': n, 
+        'g_prob': g, 
+        'L_L': nodes[:, :, 0], 
+        'L_G': nodes[:, :, 1], 
+        'L_L_sem': nodes[:, :, 2], 
+        'L_G_sem': nodes[:, :, 3], 
+        'bounds': cells.reshape(n_count - 1, g_count - 1, 2).astype(float), 
+        'suffix': h['suffix'].decode()
+    }
+
+def lookup_surface(surface: dict, n, g_prob):
+    """
+    Interpolate L_L and L_G from a surface, the same way as `gen lookup`
+    1 / L_L and 1 / L_G are interpolated bilinearly; the error is one SEM plus the 
+    interpolation bound. Points outside the grid give NaN.
+
+    Args:
+        surface (dict): surface from load_surface()
+        n (float or array): degree of polymerization
+        g_prob (float or array): probability of G
+
+    Returns:
+        4 element tuple: (L_L, L_L_err, L_G, L_G_err)
+    """
+    n, g_prob = np.broadcast_arrays(np.asarray(n, dtype=float), np.asarray(g_prob, dtype=float))
+    ns, gs = surface['n'], surface['g_prob']
+    inside = (n >= ns[0]) & (n <= ns[-1]) & (g_prob >= gs[0]) & (g_prob <= gs[-1])
+    i = np.clip(np.searchsorted(ns, n, side='right'), 1, len(ns) - 1) - 1
+    j = np.clip(np.searchsorted(gs, g_prob, side='right'), 1, len(gs) - 1) - 1
+    u = (n - ns[i]) / (ns[i + 1] - ns[i])
+    v = (g_prob - gs[j]) / (gs[j + 1] - gs[j])
+
+    def bilinear(values):
+        return ((1 - u) * ((1 - v) * values[i, j] + v * values[i, j + 1]) 
+                + u * ((1 - v) * values[i + 1, j] + v * values[i + 1, j + 1]))
+
+    L_L = 1 / bilinear(1 / surface['L_L'])
+    L_G = 1 / bilinear(1 / surface['L_G'])
+    L_L_err = bilinear(surface['L_L_sem']) + L_L ** 2 * surface['bounds'][i, j, 0]
+    L_G_err = bilinear(surface['L_G_sem']) + L_G ** 2 * surface['bounds'][i, j, 1]
+
+    result = [np.where(inside, x, np.nan) for x in (L_L, L_L_err, L_G, L_G_err)]
+    return tuple(x[()] for x in result)
+
 def main():
     N = 10000
     p_length = 100